@@ -0,0 +1,250 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+
+#include "admission.h"
+
+#define STRINGIFY_VALUE(x) #x
+#define STRINGIFY(x) STRINGIFY_VALUE(x)
+
+static const char RESPONSE_UNAVAILABLE[] =
+    "HTTP/1.1 503 Service Unavailable\r\n"
+    "Retry-After: " STRINGIFY(ADMISSION_RETRY_AFTER) "\r\n"
+    "Content-Length: 0\r\n"
+    "Access-Control-Allow-Origin: *\r\n"
+    "Connection: close\r\n"
+    "\r\n";
+
+static const char RESPONSE_TOO_MANY_REQUESTS[] =
+    "HTTP/1.1 429 Too Many Requests\r\n"
+    "Retry-After: " STRINGIFY(ADMISSION_RETRY_AFTER) "\r\n"
+    "Content-Length: 0\r\n"
+    "Access-Control-Allow-Origin: *\r\n"
+    "Connection: close\r\n"
+    "\r\n";
+
+/**
+ * @brief Соединение, получившее 503 и ожидающее запроса клиента перед закрытием.
+ */
+typedef struct
+{
+    int fd;
+    uint64_t shed_at;
+} LingeringConnection;
+
+static LingeringConnection lingering[ADMISSION_LINGER_MAX];
+static unsigned int lingering_count = 0;
+
+static unsigned int queue_depth = ADMISSION_DEFAULT_QUEUE_DEPTH;
+static unsigned int deadline_ms = 0;
+static AdmissionStats *stats = NULL;
+
+/** Дедлайн запроса, который обслуживает текущий поток (0 - нет). */
+static __thread uint64_t current_deadline = 0;
+
+/** Момент accept запроса, который обслуживает текущий поток (0 - нет). */
+static __thread uint64_t current_accepted_at = 0;
+
+int admission_init(unsigned int depth, unsigned int deadline)
+{
+    queue_depth = depth;
+    deadline_ms = deadline;
+
+    stats = mmap(NULL, sizeof(AdmissionStats), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (stats == MAP_FAILED)
+    {
+        perror("mmap");
+        stats = NULL;
+        return -1;
+    }
+    memset(stats, 0, sizeof(*stats));
+    return 0;
+}
+
+void admission_destroy(void)
+{
+    if (stats != NULL)
+        munmap(stats, sizeof(AdmissionStats));
+    stats = NULL;
+}
+
+unsigned int admission_queue_depth(void)
+{
+    return queue_depth;
+}
+
+unsigned int admission_deadline_ms(void)
+{
+    return deadline_ms;
+}
+
+uint64_t admission_now_ms(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000 + now.tv_nsec / 1000000;
+}
+
+void admission_begin(uint64_t accepted_at)
+{
+    current_deadline = deadline_ms > 0 ? accepted_at + deadline_ms : 0;
+    current_accepted_at = accepted_at;
+    if (stats != NULL)
+        __atomic_fetch_add(&stats->admitted, 1, __ATOMIC_RELAXED);
+}
+
+void admission_end(void)
+{
+    current_deadline = 0;
+    current_accepted_at = 0;
+}
+
+long admission_waited_ms(void)
+{
+    if (current_accepted_at == 0)
+        return -1;
+
+    uint64_t now = admission_now_ms();
+    return now > current_accepted_at ? (long)(now - current_accepted_at) : 0;
+}
+
+long admission_remaining_ms(void)
+{
+    if (current_deadline == 0)
+        return -1;
+
+    uint64_t now = admission_now_ms();
+    return now < current_deadline ? (long)(current_deadline - now) : 0;
+}
+
+int admission_expired(void)
+{
+    return admission_remaining_ms() == 0;
+}
+
+/**
+ * @brief Учитывает отказ в общих счетчиках.
+ */
+static void count_shed(ShedReason reason)
+{
+    if (stats == NULL)
+        return;
+    if (reason == SHED_QUEUE_FULL)
+        __atomic_fetch_add(&stats->shed_queue_full, 1, __ATOMIC_RELAXED);
+    else if (reason == SHED_RATE_LIMIT)
+        __atomic_fetch_add(&stats->shed_rate_limit, 1, __ATOMIC_RELAXED);
+    else
+        __atomic_fetch_add(&stats->shed_deadline, 1, __ATOMIC_RELAXED);
+}
+
+/**
+ * @brief Готовый ответ для причины отказа.
+ */
+static const char *shed_text(ShedReason reason, size_t *len)
+{
+    if (reason == SHED_RATE_LIMIT)
+    {
+        *len = sizeof(RESPONSE_TOO_MANY_REQUESTS) - 1;
+        return RESPONSE_TOO_MANY_REQUESTS;
+    }
+    *len = sizeof(RESPONSE_UNAVAILABLE) - 1;
+    return RESPONSE_UNAVAILABLE;
+}
+
+char *admission_shed_response(ShedReason reason, size_t *response_len)
+{
+    size_t len;
+    const char *text = shed_text(reason, &len);
+    char *response = malloc(len);
+
+    count_shed(reason);
+    if (response == NULL)
+    {
+        perror("malloc");
+        return NULL;
+    }
+    memcpy(response, text, len);
+    *response_len = len;
+    return response;
+}
+
+/**
+ * @brief Вычитывает пришедшие данные без ожидания.
+ *
+ * @return 1, если клиент закрыл соединение или произошла ошибка, иначе 0.
+ */
+static int drain_request(int fd)
+{
+    char discard[1024];
+    ssize_t len;
+
+    while ((len = recv(fd, discard, sizeof(discard), MSG_DONTWAIT)) > 0)
+        ;
+    return len == 0 || (errno != EAGAIN && errno != EWOULDBLOCK);
+}
+
+void admission_shed_connection(int client_sock, ShedReason reason)
+{
+    size_t len;
+    const char *text = shed_text(reason, &len);
+
+    count_shed(reason);
+
+    // Ответ уходит сразу, но сокет закрывается только после запроса клиента: закрытие
+    // до него сломало бы клиенту отправку (EPIPE), а с непрочитанными данными - сбросило бы соединение
+    drain_request(client_sock);
+    send(client_sock, text, len, MSG_DONTWAIT | MSG_NOSIGNAL);
+    shutdown(client_sock, SHUT_WR);
+
+    if (lingering_count == ADMISSION_LINGER_MAX)
+    {
+        close(lingering[0].fd);
+        memmove(&lingering[0], &lingering[1], (ADMISSION_LINGER_MAX - 1) * sizeof(LingeringConnection));
+        lingering_count--;
+    }
+    lingering[lingering_count].fd = client_sock;
+    lingering[lingering_count].shed_at = admission_now_ms();
+    lingering_count++;
+}
+
+void admission_reap_shed(int close_all)
+{
+    uint64_t now = admission_now_ms();
+    unsigned int kept = 0;
+
+    for (unsigned int i = 0; i < lingering_count; i++)
+    {
+        LingeringConnection *conn = &lingering[i];
+
+        if (close_all || drain_request(conn->fd) || now - conn->shed_at >= ADMISSION_LINGER_MS)
+            close(conn->fd);
+        else
+            lingering[kept++] = *conn;
+    }
+    lingering_count = kept;
+}
+
+unsigned int admission_shed_pending(void)
+{
+    return lingering_count;
+}
+
+void admission_get_stats(AdmissionStats *out)
+{
+    if (stats == NULL)
+    {
+        memset(out, 0, sizeof(*out));
+        return;
+    }
+    out->admitted = __atomic_load_n(&stats->admitted, __ATOMIC_RELAXED);
+    out->shed_queue_full = __atomic_load_n(&stats->shed_queue_full, __ATOMIC_RELAXED);
+    out->shed_deadline = __atomic_load_n(&stats->shed_deadline, __ATOMIC_RELAXED);
+    out->shed_rate_limit = __atomic_load_n(&stats->shed_rate_limit, __ATOMIC_RELAXED);
+}
@@ -0,0 +1,136 @@
+#ifndef ADMISSION_H
+#define ADMISSION_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define ADMISSION_DEFAULT_QUEUE_DEPTH 64  /**< Очередь ожидающих запросов по умолчанию (на процесс). */
+#define ADMISSION_DEFAULT_DEADLINE_MS 3000 /**< Дедлайн запроса по умолчанию, мс. */
+#define ADMISSION_RETRY_AFTER 1           /**< Значение `Retry-After` в ответе 503, секунды. */
+#define ADMISSION_LINGER_MAX 256          /**< Сколько отклоненных соединений ждут запроса перед закрытием. */
+#define ADMISSION_LINGER_MS 1000          /**< Сколько ждать запроса от отклоненного соединения, мс. */
+
+/**
+ * @brief Причина отказа в обслуживании.
+ */
+typedef enum
+{
+    SHED_QUEUE_FULL, /**< Очередь ожидающих запросов заполнена - отказ сразу после accept. */
+    SHED_DEADLINE,   /**< Дедлайн истек в очереди или во время DNS/геопоиска. */
+    SHED_RATE_LIMIT  /**< Клиент превысил свою скорость (`--peer-limit`) - ответ 429. */
+} ShedReason;
+
+/**
+ * @brief Счетчики ограничения нагрузки (общие для всех рабочих процессов).
+ */
+typedef struct
+{
+    unsigned long admitted;        /**< Запросы, принятые в очередь. */
+    unsigned long shed_queue_full; /**< Отказы из-за заполненной очереди. */
+    unsigned long shed_deadline;   /**< Отказы из-за истекшего дедлайна. */
+    unsigned long shed_rate_limit; /**< Отказы из-за превышения скорости клиентом. */
+} AdmissionStats;
+
+/**
+ * @brief Задает глубину очереди и дедлайн запроса.
+ *
+ * Счетчики размещаются в анонимной памяти MAP_SHARED, поэтому функция
+ * вызывается до fork рабочих процессов, и все они пишут в одни счетчики.
+ *
+ * @param queue_depth Максимум принятых, но еще не обслуженных соединений на процесс.
+ * @param deadline_ms Сколько миллисекунд от accept дается на ответ (0 - без дедлайна).
+ * @return 0 при успехе, -1 при ошибке.
+ */
+int admission_init(unsigned int queue_depth, unsigned int deadline_ms);
+
+/**
+ * @brief Освобождает счетчики.
+ */
+void admission_destroy(void);
+
+/**
+ * @brief Возвращает глубину очереди ожидающих запросов.
+ */
+unsigned int admission_queue_depth(void);
+
+/**
+ * @brief Возвращает дедлайн запроса в миллисекундах (0 - без дедлайна).
+ */
+unsigned int admission_deadline_ms(void);
+
+/**
+ * @brief Монотонное время в миллисекундах (для отметки момента accept).
+ */
+uint64_t admission_now_ms(void);
+
+/**
+ * @brief Начинает обслуживание запроса, принятого в `accepted_at`, в текущем потоке.
+ *
+ * Учитывает запрос как принятый и запоминает его дедлайн, который затем
+ * проверяют `build_response` и `get_dns_info_ttl`.
+ */
+void admission_begin(uint64_t accepted_at);
+
+/**
+ * @brief Завершает обслуживание запроса в текущем потоке.
+ */
+void admission_end(void);
+
+/**
+ * @brief Сколько миллисекунд осталось до дедлайна текущего запроса.
+ *
+ * @return Остаток (0, если дедлайн истек) или -1, если дедлайна нет.
+ */
+long admission_remaining_ms(void);
+
+/**
+ * @brief Сколько миллисекунд прошло от accept текущего запроса.
+ *
+ * @return Прошедшее время или -1 вне `admission_begin`/`admission_end`.
+ */
+long admission_waited_ms(void);
+
+/**
+ * @brief Проверяет, истек ли дедлайн текущего запроса.
+ */
+int admission_expired(void);
+
+/**
+ * @brief Возвращает копию ответа 503 (429 для SHED_RATE_LIMIT) с `Retry-After` и учитывает отказ.
+ *
+ * @param reason Причина отказа.
+ * @param response_len Длина ответа.
+ * @return Ответ, выделенный через malloc, или NULL.
+ */
+char *admission_shed_response(ShedReason reason, size_t *response_len);
+
+/**
+ * @brief Отказывает соединению сразу после accept: отвечает 503 (или 429) без ожидания.
+ *
+ * Сокет закрывается не сразу, а в `admission_reap_shed`, когда клиент допишет
+ * запрос (или через ADMISSION_LINGER_MS), чтобы клиент успел отправить запрос
+ * и прочитать ответ. Вызывается из одного потока (цикла accept).
+ *
+ * @param client_sock Принятое соединение.
+ * @param reason Причина отказа.
+ */
+void admission_shed_connection(int client_sock, ShedReason reason);
+
+/**
+ * @brief Закрывает отклоненные соединения, клиенты которых дописали запрос.
+ *
+ * @param close_all 1 - закрыть все (при остановке).
+ */
+void admission_reap_shed(int close_all);
+
+/**
+ * @brief Сколько отклоненных соединений еще ждут закрытия в `admission_reap_shed`.
+ */
+unsigned int admission_shed_pending(void);
+
+/**
+ * @brief Копирует текущие значения счетчиков.
+ */
+void admission_get_stats(AdmissionStats *stats);
+
+#endif // ADMISSION_H
@@ -0,0 +1,222 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <time.h>
+#include <json-c/json.h>
+#include <maxminddb.h>
+
+#include "batch.h"
+#include "unix-server.h"
+#include "domain_name.h"
+
+/**
+ * @brief Общее состояние пакетной обработки.
+ */
+typedef struct
+{
+    FILE *in;                 /**< Входной поток доменов. */
+    const MMDB_s *mmdb;       /**< База MaxMind (только чтение, безопасна для потоков). */
+    BatchFormat format;       /**< Формат вывода. */
+    pthread_mutex_t in_lock;  /**< Защищает чтение из `in`. */
+    pthread_mutex_t out_lock; /**< Защищает stdout и счетчики. */
+    sem_t inflight;           /**< Окно одновременных DNS-запросов. */
+    unsigned long processed;  /**< Обработано доменов. */
+    unsigned long resolved;   /**< Доменов, для которых найдены IP-адреса. */
+    unsigned long located;    /**< Доменов, для которых определена страна. */
+    unsigned long rejected;   /**< Строк, не похожих на имя домена. */
+} BatchContext;
+
+/**
+ * @brief Пишет поле CSV, экранируя его при необходимости.
+ */
+static void csv_field(FILE *out, const char *value)
+{
+    if (strpbrk(value, ",\"\r\n") == NULL)
+    {
+        fputs(value, out);
+        return;
+    }
+
+    fputc('"', out);
+    for (const char *p = value; *p; p++)
+    {
+        if (*p == '"')
+            fputc('"', out);
+        fputc(*p, out);
+    }
+    fputc('"', out);
+}
+
+/**
+ * @brief Убирает пробельные символы в начале и конце строки.
+ */
+static char *trim(char *s)
+{
+    char *end;
+
+    while (*s == ' ' || *s == '\t')
+        s++;
+    end = s + strlen(s);
+    while (end > s && (end[-1] == ' ' || end[-1] == '\t' || end[-1] == '\r' || end[-1] == '\n'))
+        *--end = '\0';
+    return s;
+}
+
+/**
+ * @brief Выводит результат для одного домена. Вызывается под `out_lock`.
+ */
+static void write_result(BatchContext *ctx, const char *domain, const char *ips,
+                         const char *country_code, const Flag *flag)
+{
+    if (ctx->format == BATCH_FORMAT_NDJSON)
+    {
+        struct json_object *json_obj = json_object_new_object();
+        json_object_object_add(json_obj, "domain", json_object_new_string(domain));
+        json_object_object_add(json_obj, "ips", json_object_new_string(ips));
+        json_object_object_add(json_obj, "countryCode", json_object_new_string(country_code));
+        if (flag)
+            json_object_object_add(json_obj, "countryName", json_object_new_string(flag->name));
+        fputs(json_object_to_json_string_ext(json_obj, JSON_C_TO_STRING_PLAIN), stdout);
+        fputc('\n', stdout);
+        json_object_put(json_obj);
+        return;
+    }
+
+    csv_field(stdout, domain);
+    fputc(',', stdout);
+    csv_field(stdout, ips);
+    fputc(',', stdout);
+    csv_field(stdout, country_code);
+    fputc(',', stdout);
+    csv_field(stdout, flag ? flag->name : "");
+    fputc('\n', stdout);
+}
+
+/**
+ * @brief Рабочий поток: берет очередной домен из входа и геолоцирует его.
+ */
+static void *batch_worker(void *arg)
+{
+    BatchContext *ctx = arg;
+    char line[BUFFER_SIZE];
+    char ips[BUFFER_SIZE];
+    char first_ip[BUFFER_SIZE];
+    char country_code[16];
+
+    while (1)
+    {
+        pthread_mutex_lock(&ctx->in_lock);
+        char *got = fgets(line, sizeof(line), ctx->in);
+        pthread_mutex_unlock(&ctx->in_lock);
+        if (got == NULL)
+            break;
+
+        char *input = trim(line);
+        if (input[0] == '\0' || input[0] == '#')
+            continue;
+
+        // Домен попадает в командную строку `dig`, поэтому пропускаем все, что не похоже на имя хоста
+        char domain[DOMAIN_NAME_MAX + 1];
+        if (domain_canonicalize(input, strlen(input), domain) < 0)
+        {
+            pthread_mutex_lock(&ctx->out_lock);
+            ctx->rejected++;
+            pthread_mutex_unlock(&ctx->out_lock);
+            fprintf(stderr, "Пропущена некорректная строка: %s\n", input);
+            continue;
+        }
+
+        // Ограничиваем количество одновременных DNS-запросов
+        ips[0] = '\0';
+        sem_wait(&ctx->inflight);
+        get_dns_info(domain, ips, sizeof(ips));
+        sem_post(&ctx->inflight);
+
+        // Убираем завершающий пробел, который оставляет get_dns_info
+        size_t ips_len = strlen(ips);
+        if (ips_len > 0 && ips[ips_len - 1] == ' ')
+            ips[ips_len - 1] = '\0';
+
+        const Flag *flag = NULL;
+        country_code[0] = '\0';
+        if (ips[0] != '\0')
+        {
+            extract_first_ip(ips, first_ip, sizeof(first_ip));
+            flag = get_geo_info(ctx->mmdb, first_ip, country_code, sizeof(country_code));
+        }
+
+        pthread_mutex_lock(&ctx->out_lock);
+        write_result(ctx, domain, ips, country_code, flag);
+        ctx->processed++;
+        ctx->resolved += ips[0] != '\0';
+        ctx->located += country_code[0] != '\0';
+        pthread_mutex_unlock(&ctx->out_lock);
+    }
+
+    return NULL;
+}
+
+int run_batch(const char *path, BatchFormat format, int threads, int inflight, const MMDB_s *mmdb)
+{
+    BatchContext ctx;
+    pthread_t *workers;
+    struct timespec start, end;
+    int started = 0;
+
+    memset(&ctx, 0, sizeof(ctx));
+    ctx.in = strcmp(path, "-") == 0 ? stdin : fopen(path, "r");
+    if (ctx.in == NULL)
+    {
+        perror("fopen");
+        return EXIT_FAILURE;
+    }
+    ctx.mmdb = mmdb;
+    ctx.format = format;
+    pthread_mutex_init(&ctx.in_lock, NULL);
+    pthread_mutex_init(&ctx.out_lock, NULL);
+    sem_init(&ctx.inflight, 0, (unsigned int)inflight);
+
+    workers = calloc(threads, sizeof(pthread_t));
+    if (workers == NULL)
+    {
+        perror("calloc");
+        if (ctx.in != stdin)
+            fclose(ctx.in);
+        return EXIT_FAILURE;
+    }
+
+    if (format == BATCH_FORMAT_CSV)
+        fputs("domain,ips,country_code,country_name\n", stdout);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int i = 0; i < threads; i++)
+    {
+        if (pthread_create(&workers[i], NULL, batch_worker, &ctx) != 0)
+        {
+            perror("pthread_create");
+            break;
+        }
+        started++;
+    }
+    for (int i = 0; i < started; i++)
+        pthread_join(workers[i], NULL);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    fflush(stdout);
+
+    double elapsed = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+    fprintf(stderr,
+            "Обработано доменов: %lu за %.2f с (%.1f доменов/с), с IP: %lu, со страной: %lu, отклонено: %lu\n",
+            ctx.processed, elapsed, elapsed > 0 ? ctx.processed / elapsed : 0.0,
+            ctx.resolved, ctx.located, ctx.rejected);
+
+    free(workers);
+    sem_destroy(&ctx.inflight);
+    pthread_mutex_destroy(&ctx.in_lock);
+    pthread_mutex_destroy(&ctx.out_lock);
+    if (ctx.in != stdin)
+        fclose(ctx.in);
+
+    return started > 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
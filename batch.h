@@ -0,0 +1,34 @@
+#ifndef BATCH_H
+#define BATCH_H
+
+#include <maxminddb.h>
+
+/**
+ * @brief Формат вывода пакетного режима.
+ */
+typedef enum
+{
+    BATCH_FORMAT_CSV,   /**< CSV с заголовком: domain,ips,country_code,country_name */
+    BATCH_FORMAT_NDJSON /**< Один JSON-объект на строку. */
+} BatchFormat;
+
+/**
+ * @brief Геолоцирует список доменов из файла и пишет результат в stdout.
+ *
+ * Домены читаются построчно (пустые строки и строки с `#` пропускаются) и
+ * обрабатываются пулом из `threads` потоков теми же функциями, что и сервер:
+ * `get_dns_info` и `get_geo_info`. Одновременно выполняется не более
+ * `inflight` DNS-запросов. Результаты выводятся по мере готовности, поэтому
+ * порядок строк может не совпадать с входным. По завершении в stderr
+ * печатается сводка с пропускной способностью.
+ *
+ * @param path Путь к файлу доменов или "-" для чтения из stdin.
+ * @param format Формат вывода.
+ * @param threads Количество рабочих потоков.
+ * @param inflight Максимум одновременных DNS-запросов.
+ * @param mmdb Открытая база MaxMind.
+ * @return EXIT_SUCCESS или EXIT_FAILURE, если файл не удалось открыть.
+ */
+int run_batch(const char *path, BatchFormat format, int threads, int inflight, const MMDB_s *mmdb);
+
+#endif // BATCH_H
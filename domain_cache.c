@@ -0,0 +1,668 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <pthread.h>
+#include <signal.h>
+#include <arpa/inet.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "domain_cache.h"
+
+_Static_assert(sizeof(DomainCacheRecord) == 304, "раскладка DomainCacheRecord входит в формат снимка");
+_Static_assert(sizeof(SnapshotHeader) == 32, "раскладка SnapshotHeader входит в формат снимка");
+
+/**
+ * @brief Элемент цепочки хеш-таблицы.
+ */
+typedef struct CacheNode
+{
+    DomainCacheRecord record;
+    unsigned int hits;       /**< Обращений с момента последнего обновления записи. */
+    int refreshing;          /**< 1, пока запись стоит в очереди фонового обновления. */
+    struct CacheNode *next;
+} CacheNode;
+
+#define REFRESH_QUEUE_SIZE 1024
+#define EVICT_CANDIDATES 8 /**< Сколько записей просматривает вытеснение при заполненном кэше. */
+
+static CacheNode **buckets = NULL;
+static size_t bucket_count = 0;
+static size_t entry_count = 0;
+static size_t max_entries = 0;
+static pthread_rwlock_t cache_lock = PTHREAD_RWLOCK_INITIALIZER;
+
+static pthread_t snapshot_thread;
+static int snapshot_running = 0;
+static const char *snapshot_path = NULL;
+static unsigned int snapshot_interval = 0;
+static pthread_mutex_t snapshot_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t snapshot_cond = PTHREAD_COND_INITIALIZER;
+
+static pthread_t refresh_thread;
+static int refresh_running = 0;
+static unsigned int refresh_window = 0;
+static unsigned int refresh_min_hits = 0;
+static DomainRefreshFn refresh_fn = NULL;
+static void *refresh_arg = NULL;
+static char refresh_queue[REFRESH_QUEUE_SIZE][256];
+static size_t refresh_head = 0;
+static size_t refresh_len = 0;
+static pthread_mutex_t refresh_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t refresh_cond = PTHREAD_COND_INITIALIZER;
+
+/**
+ * @brief Запускает служебный поток с заблокированными сигналами.
+ *
+ * Сигналы завершения должны доставляться основному потоку, чтобы прерывать accept.
+ */
+static int spawn_thread(pthread_t *thread, void *(*fn)(void *))
+{
+    sigset_t all, old;
+    int rc;
+
+    sigfillset(&all);
+    pthread_sigmask(SIG_BLOCK, &all, &old);
+    rc = pthread_create(thread, NULL, fn, NULL);
+    pthread_sigmask(SIG_SETMASK, &old, NULL);
+
+    if (rc != 0)
+        fprintf(stderr, "pthread_create: %s\n", strerror(rc));
+    return rc == 0 ? 0 : -1;
+}
+
+/**
+ * @brief Ставит домен в очередь фонового обновления.
+ *
+ * @return 1, если домен поставлен в очередь, 0 - если очередь заполнена.
+ */
+static int enqueue_refresh(const char *domain)
+{
+    int queued = 0;
+
+    pthread_mutex_lock(&refresh_lock);
+    if (refresh_running && refresh_len < REFRESH_QUEUE_SIZE)
+    {
+        size_t tail = (refresh_head + refresh_len) % REFRESH_QUEUE_SIZE;
+        snprintf(refresh_queue[tail], sizeof(refresh_queue[tail]), "%s", domain);
+        refresh_len++;
+        queued = 1;
+        pthread_cond_signal(&refresh_cond);
+    }
+    pthread_mutex_unlock(&refresh_lock);
+
+    return queued;
+}
+
+/**
+ * @brief Хеш FNV-1a имени домена.
+ */
+static uint64_t hash_domain(const char *domain)
+{
+    uint64_t hash = 1469598103934665603ULL;
+    for (const unsigned char *p = (const unsigned char *)domain; *p; p++)
+    {
+        hash ^= *p;
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+int domain_cache_init(size_t max)
+{
+    bucket_count = 1;
+    while (bucket_count < max)
+        bucket_count <<= 1;
+
+    buckets = calloc(bucket_count, sizeof(CacheNode *));
+    if (buckets == NULL)
+    {
+        perror("calloc");
+        return -1;
+    }
+    max_entries = max;
+    entry_count = 0;
+    return 0;
+}
+
+void domain_cache_destroy(void)
+{
+    pthread_rwlock_wrlock(&cache_lock);
+    for (size_t i = 0; i < bucket_count; i++)
+    {
+        CacheNode *node = buckets[i];
+        while (node != NULL)
+        {
+            CacheNode *next = node->next;
+            free(node);
+            node = next;
+        }
+    }
+    free(buckets);
+    buckets = NULL;
+    bucket_count = 0;
+    entry_count = 0;
+    pthread_rwlock_unlock(&cache_lock);
+}
+
+int domain_cache_get(const char *domain, DomainCacheRecord *record)
+{
+    int found = 0;
+
+    if (buckets == NULL)
+        return 0;
+
+    pthread_rwlock_rdlock(&cache_lock);
+    for (CacheNode *node = buckets[hash_domain(domain) & (bucket_count - 1)]; node != NULL; node = node->next)
+    {
+        if (strcmp(node->record.domain, domain) == 0)
+        {
+            int64_t now = time(NULL);
+            if (node->record.expires_at > now)
+            {
+                *record = node->record;
+                found = 1;
+
+                // Популярную запись, срок которой подходит к концу, обновляем в фоне,
+                // а до тех пор продолжаем отдавать текущий (еще валидный) ответ
+                unsigned int hits = __atomic_add_fetch(&node->hits, 1, __ATOMIC_RELAXED);
+                int expected = 0;
+                if (refresh_window > 0 && hits >= refresh_min_hits &&
+                    node->record.expires_at - now <= (int64_t)refresh_window &&
+                    __atomic_compare_exchange_n(&node->refreshing, &expected, 1, 0, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED) &&
+                    !enqueue_refresh(domain))
+                {
+                    __atomic_store_n(&node->refreshing, 0, __ATOMIC_RELEASE);
+                }
+            }
+            break;
+        }
+    }
+    pthread_rwlock_unlock(&cache_lock);
+
+    return found;
+}
+
+/**
+ * @brief Вынимает из таблицы запись для повторного использования.
+ *
+ * Начиная с корзины `slot`, просматривает до EVICT_CANDIDATES записей и берет
+ * первую истекшую, а если таких нет - ту, что истекает раньше всех. Вызывается
+ * под блокировкой на запись, когда кэш заполнен.
+ *
+ * @return Вынутый из цепочки узел или NULL, если таблица пуста.
+ */
+static CacheNode *evict_node(CacheNode **slot)
+{
+    size_t start = slot - buckets;
+    CacheNode **victim = NULL;
+    int64_t now = time(NULL);
+    int seen = 0;
+
+    for (size_t i = 0; i < bucket_count && seen < EVICT_CANDIDATES; i++)
+    {
+        for (CacheNode **link = &buckets[(start + i) & (bucket_count - 1)]; *link != NULL; link = &(*link)->next)
+        {
+            if (victim == NULL || (*link)->record.expires_at < (*victim)->record.expires_at)
+                victim = link;
+            seen++;
+            if ((*link)->record.expires_at <= now || seen >= EVICT_CANDIDATES)
+                break;
+        }
+        if (victim != NULL && (*victim)->record.expires_at <= now)
+            break;
+    }
+
+    if (victim == NULL)
+        return NULL;
+
+    CacheNode *node = *victim;
+    *victim = node->next;
+    return node;
+}
+
+/**
+ * @brief Вставляет готовую запись. Вызывается под блокировкой на запись.
+ */
+static void insert_record(const DomainCacheRecord *record)
+{
+    CacheNode **slot = &buckets[hash_domain(record->domain) & (bucket_count - 1)];
+
+    for (CacheNode *node = *slot; node != NULL; node = node->next)
+    {
+        if (strcmp(node->record.domain, record->domain) == 0)
+        {
+            // Обновленная запись начинает новый период подсчета популярности
+            node->record = *record;
+            node->hits = 0;
+            node->refreshing = 0;
+            return;
+        }
+    }
+
+    // Кэш заполнен: освобождаем место сразу, не дожидаясь очистки истекших записей
+    CacheNode *node = entry_count >= max_entries ? evict_node(slot) : NULL;
+    if (node == NULL)
+    {
+        if (entry_count >= max_entries)
+            return;
+        node = malloc(sizeof(CacheNode));
+        if (node == NULL)
+            return;
+        entry_count++;
+    }
+
+    memset(node, 0, sizeof(*node));
+    node->record = *record;
+    node->next = *slot;
+    *slot = node;
+}
+
+int domain_cache_make_record(const char *domain, const char *ips, const char *country_code, unsigned int ttl,
+                             DomainCacheRecord *record)
+{
+    char copy[1024];
+    char *save = NULL;
+
+    if (strlen(domain) >= sizeof(record->domain))
+        return -1;
+
+    memset(record, 0, sizeof(*record));
+    snprintf(record->domain, sizeof(record->domain), "%s", domain);
+    snprintf(record->country_code, sizeof(record->country_code), "%s", country_code);
+    record->expires_at = (int64_t)time(NULL) + ttl;
+
+    // Переводим строку адресов в компактный двоичный вид
+    snprintf(copy, sizeof(copy), "%s", ips);
+    for (char *tok = strtok_r(copy, " ", &save); tok != NULL && record->ip_count < CACHE_MAX_IPS;
+         tok = strtok_r(NULL, " ", &save))
+    {
+        struct in_addr addr;
+        if (inet_pton(AF_INET, tok, &addr) == 1)
+            record->ipv4[record->ip_count++] = addr.s_addr;
+    }
+
+    return 0;
+}
+
+void domain_cache_put(const char *domain, const char *ips, const char *country_code, unsigned int ttl)
+{
+    DomainCacheRecord record;
+
+    if (domain_cache_make_record(domain, ips, country_code, ttl, &record) == 0)
+        domain_cache_put_record(&record);
+}
+
+void domain_cache_put_record(const DomainCacheRecord *record)
+{
+    if (buckets == NULL)
+        return;
+
+    pthread_rwlock_wrlock(&cache_lock);
+    insert_record(record);
+    pthread_rwlock_unlock(&cache_lock);
+}
+
+void domain_cache_foreach(void (*fn)(const DomainCacheRecord *record, void *arg), void *arg)
+{
+    int64_t now = time(NULL);
+
+    if (buckets == NULL)
+        return;
+
+    pthread_rwlock_rdlock(&cache_lock);
+    for (size_t i = 0; i < bucket_count; i++)
+    {
+        for (CacheNode *node = buckets[i]; node != NULL; node = node->next)
+        {
+            if (node->record.expires_at > now)
+                fn(&node->record, arg);
+        }
+    }
+    pthread_rwlock_unlock(&cache_lock);
+}
+
+size_t domain_cache_purge_expired(void)
+{
+    size_t removed = 0;
+    int64_t now = time(NULL);
+
+    if (buckets == NULL)
+        return 0;
+
+    pthread_rwlock_wrlock(&cache_lock);
+    for (size_t i = 0; i < bucket_count; i++)
+    {
+        CacheNode **slot = &buckets[i];
+        while (*slot != NULL)
+        {
+            if ((*slot)->record.expires_at <= now)
+            {
+                CacheNode *dead = *slot;
+                *slot = dead->next;
+                free(dead);
+                entry_count--;
+                removed++;
+            }
+            else
+            {
+                slot = &(*slot)->next;
+            }
+        }
+    }
+    pthread_rwlock_unlock(&cache_lock);
+
+    return removed;
+}
+
+void domain_cache_format_ips(const DomainCacheRecord *record, char *ips, size_t ips_size)
+{
+    char addr[INET_ADDRSTRLEN];
+
+    ips[0] = '\0';
+    for (int i = 0; i < record->ip_count; i++)
+    {
+        inet_ntop(AF_INET, &record->ipv4[i], addr, sizeof(addr));
+        strncat(ips, addr, ips_size - strlen(ips) - 1);
+        strncat(ips, " ", ips_size - strlen(ips) - 1);
+    }
+}
+
+/**
+ * @brief Записывает буфер целиком, повторяя write при частичной записи.
+ */
+static int write_all(int fd, const void *data, size_t len)
+{
+    const char *p = data;
+
+    while (len > 0)
+    {
+        ssize_t written = write(fd, p, len);
+        if (written < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            return -1;
+        }
+        p += written;
+        len -= written;
+    }
+    return 0;
+}
+
+long domain_cache_save_fd(int fd)
+{
+    SnapshotHeader header;
+    DomainCacheRecord *records;
+    size_t count = 0;
+    int64_t now = time(NULL);
+
+    if (buckets == NULL)
+        return -1;
+
+    // Копируем живые записи под блокировкой, а пишем уже без нее
+    pthread_rwlock_rdlock(&cache_lock);
+    records = malloc((entry_count ? entry_count : 1) * sizeof(DomainCacheRecord));
+    if (records != NULL)
+    {
+        for (size_t i = 0; i < bucket_count; i++)
+        {
+            for (CacheNode *node = buckets[i]; node != NULL; node = node->next)
+            {
+                if (node->record.expires_at > now)
+                    records[count++] = node->record;
+            }
+        }
+    }
+    pthread_rwlock_unlock(&cache_lock);
+
+    if (records == NULL)
+    {
+        perror("malloc");
+        return -1;
+    }
+
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+    header.version = SNAPSHOT_VERSION;
+    header.record_size = sizeof(DomainCacheRecord);
+    header.record_count = count;
+    header.created_at = now;
+
+    int ok = write_all(fd, &header, sizeof(header)) == 0 &&
+             write_all(fd, records, count * sizeof(DomainCacheRecord)) == 0;
+    free(records);
+
+    return ok ? (long)count : -1;
+}
+
+long domain_cache_save(const char *path)
+{
+    char tmp_path[4096];
+
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+    int fd = open(tmp_path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0)
+    {
+        perror("open");
+        return -1;
+    }
+
+    long count = domain_cache_save_fd(fd);
+    int ok = count >= 0;
+    ok = fsync(fd) == 0 && ok;
+    ok = close(fd) == 0 && ok;
+
+    if (!ok || rename(tmp_path, path) < 0)
+    {
+        perror("snapshot");
+        unlink(tmp_path);
+        return -1;
+    }
+
+    return count;
+}
+
+long domain_cache_load_fd(int fd, const char *name)
+{
+    struct stat st;
+    long loaded = 0;
+    int64_t now = time(NULL);
+
+    if (buckets == NULL)
+        return -1;
+
+    if (fstat(fd, &st) < 0 || (size_t)st.st_size < sizeof(SnapshotHeader))
+        return -1;
+
+    void *map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (map == MAP_FAILED)
+    {
+        perror("mmap");
+        return -1;
+    }
+
+    const SnapshotHeader *header = map;
+    const DomainCacheRecord *records = (const DomainCacheRecord *)(header + 1);
+    size_t available = ((size_t)st.st_size - sizeof(SnapshotHeader)) / sizeof(DomainCacheRecord);
+
+    if (memcmp(header->magic, SNAPSHOT_MAGIC, sizeof(header->magic)) != 0 ||
+        header->version != SNAPSHOT_VERSION || header->record_size != sizeof(DomainCacheRecord) ||
+        header->record_count > available)
+    {
+        fprintf(stderr, "Снимок кэша %s имеет несовместимый формат и пропущен\n", name);
+        munmap(map, st.st_size);
+        return -1;
+    }
+
+    pthread_rwlock_wrlock(&cache_lock);
+    for (uint64_t i = 0; i < header->record_count; i++)
+    {
+        DomainCacheRecord record = records[i];
+        record.domain[sizeof(record.domain) - 1] = '\0';
+        record.country_code[sizeof(record.country_code) - 1] = '\0';
+        if (record.expires_at <= now || record.ip_count > CACHE_MAX_IPS)
+            continue;
+        insert_record(&record);
+        loaded++;
+    }
+    pthread_rwlock_unlock(&cache_lock);
+
+    munmap(map, st.st_size);
+    return loaded;
+}
+
+long domain_cache_load(const char *path)
+{
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return -1;
+
+    long loaded = domain_cache_load_fd(fd, path);
+    close(fd);
+    return loaded;
+}
+
+/**
+ * @brief Поток периодического сохранения снимка.
+ */
+static void *snapshot_main(void *arg)
+{
+    (void)arg;
+
+    pthread_mutex_lock(&snapshot_lock);
+    while (snapshot_running)
+    {
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_sec += snapshot_interval;
+        pthread_cond_timedwait(&snapshot_cond, &snapshot_lock, &deadline);
+        if (!snapshot_running)
+            break;
+
+        pthread_mutex_unlock(&snapshot_lock);
+        domain_cache_purge_expired();
+        domain_cache_save(snapshot_path);
+        pthread_mutex_lock(&snapshot_lock);
+    }
+    pthread_mutex_unlock(&snapshot_lock);
+
+    return NULL;
+}
+
+int domain_cache_start_snapshots(const char *path, unsigned int interval)
+{
+    snapshot_path = path;
+    snapshot_interval = interval;
+    snapshot_running = 1;
+
+    if (spawn_thread(&snapshot_thread, snapshot_main) < 0)
+    {
+        snapshot_running = 0;
+        return -1;
+    }
+    return 0;
+}
+
+void domain_cache_stop_snapshots(int save_final)
+{
+    if (!snapshot_running)
+        return;
+
+    pthread_mutex_lock(&snapshot_lock);
+    snapshot_running = 0;
+    pthread_cond_signal(&snapshot_cond);
+    pthread_mutex_unlock(&snapshot_lock);
+    pthread_join(snapshot_thread, NULL);
+
+    if (save_final)
+        domain_cache_save(snapshot_path);
+}
+
+/**
+ * @brief Снимает отметку "обновляется" с записи (например, если обновление не удалось).
+ */
+static void clear_refreshing(const char *domain)
+{
+    pthread_rwlock_rdlock(&cache_lock);
+    for (CacheNode *node = buckets[hash_domain(domain) & (bucket_count - 1)]; node != NULL; node = node->next)
+    {
+        if (strcmp(node->record.domain, domain) == 0)
+        {
+            __atomic_store_n(&node->refreshing, 0, __ATOMIC_RELEASE);
+            break;
+        }
+    }
+    pthread_rwlock_unlock(&cache_lock);
+}
+
+/**
+ * @brief Поток фонового обновления популярных записей.
+ */
+static void *refresh_main(void *arg)
+{
+    char domain[256];
+
+    (void)arg;
+    pthread_mutex_lock(&refresh_lock);
+    while (1)
+    {
+        while (refresh_running && refresh_len == 0)
+            pthread_cond_wait(&refresh_cond, &refresh_lock);
+        if (!refresh_running)
+            break;
+
+        snprintf(domain, sizeof(domain), "%s", refresh_queue[refresh_head]);
+        refresh_head = (refresh_head + 1) % REFRESH_QUEUE_SIZE;
+        refresh_len--;
+        pthread_mutex_unlock(&refresh_lock);
+
+        // Callback заново разрешает домен и при успехе вызывает domain_cache_put,
+        // который сам сбрасывает отметку; при неудаче снимаем ее здесь
+        refresh_fn(domain, refresh_arg);
+        clear_refreshing(domain);
+
+        pthread_mutex_lock(&refresh_lock);
+    }
+    pthread_mutex_unlock(&refresh_lock);
+
+    return NULL;
+}
+
+int domain_cache_start_refresher(unsigned int window, unsigned int min_hits, DomainRefreshFn fn, void *arg)
+{
+    if (window == 0 || fn == NULL)
+        return 0;
+
+    refresh_fn = fn;
+    refresh_arg = arg;
+    refresh_min_hits = min_hits;
+    refresh_running = 1;
+
+    if (spawn_thread(&refresh_thread, refresh_main) < 0)
+    {
+        refresh_running = 0;
+        return -1;
+    }
+
+    // Включаем планирование обновлений только когда поток уже работает
+    refresh_window = window;
+    return 0;
+}
+
+void domain_cache_stop_refresher(void)
+{
+    if (!refresh_running)
+        return;
+
+    refresh_window = 0;
+    pthread_mutex_lock(&refresh_lock);
+    refresh_running = 0;
+    pthread_cond_signal(&refresh_cond);
+    pthread_mutex_unlock(&refresh_lock);
+    pthread_join(refresh_thread, NULL);
+}
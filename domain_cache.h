@@ -0,0 +1,205 @@
+#ifndef DOMAIN_CACHE_H
+#define DOMAIN_CACHE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define CACHE_MAX_IPS 8                        /**< Сколько IPv4-адресов хранится на домен. */
+#define CACHE_DEFAULT_MAX_ENTRIES 100000       /**< Емкость кэша по умолчанию. */
+#define SNAPSHOT_MAGIC "GEOSNAP"               /**< Сигнатура файла снимка (8 байт с нулем). */
+#define SNAPSHOT_VERSION 1                     /**< Версия формата снимка. */
+#define DEFAULT_SNAPSHOT_PATH "./domain-cache.snap"
+#define DEFAULT_SNAPSHOT_INTERVAL 60           /**< Период записи снимка в секундах. */
+#define DEFAULT_REFRESH_WINDOW 10              /**< За сколько секунд до истечения обновлять запись. */
+#define DEFAULT_REFRESH_MIN_HITS 5             /**< Сколько обращений делает запись популярной. */
+
+/**
+ * @brief Запись кэша домен → (IP-адреса, страна, срок жизни).
+ *
+ * Структура имеет фиксированную раскладку и без изменений пишется в файл снимка,
+ * поэтому снимок можно читать через mmap как массив таких записей.
+ */
+typedef struct
+{
+    char domain[256];             /**< Имя домена, завершенное нулем. */
+    int64_t expires_at;           /**< Момент истечения (Unix time, секунды). */
+    uint32_t ipv4[CACHE_MAX_IPS]; /**< IPv4-адреса в сетевом порядке байтов. */
+    uint8_t ip_count;             /**< Количество адресов в `ipv4`. */
+    char country_code[3];         /**< Код страны ISO 3166-1 (пустая строка, если не найден). */
+    uint32_t reserved;            /**< Выравнивание, всегда 0. */
+} DomainCacheRecord;
+
+/**
+ * @brief Заголовок файла снимка. За ним следуют `record_count` записей `DomainCacheRecord`.
+ */
+typedef struct
+{
+    char magic[8];         /**< SNAPSHOT_MAGIC. */
+    uint32_t version;      /**< SNAPSHOT_VERSION. */
+    uint32_t record_size;  /**< sizeof(DomainCacheRecord) - защита от несовместимой сборки. */
+    uint64_t record_count; /**< Количество записей. */
+    int64_t created_at;    /**< Время создания снимка. */
+} SnapshotHeader;
+
+/**
+ * @brief Функция повторного разрешения домена для фонового обновления.
+ *
+ * Должна заново получить данные домена и при успехе сохранить их через `domain_cache_put`.
+ */
+typedef void (*DomainRefreshFn)(const char *domain, void *arg);
+
+/**
+ * @brief Создает пустой кэш.
+ *
+ * @param max_entries Максимальное количество записей.
+ * @return 0 при успехе, -1 при ошибке выделения памяти.
+ */
+int domain_cache_init(size_t max_entries);
+
+/**
+ * @brief Освобождает память кэша.
+ */
+void domain_cache_destroy(void);
+
+/**
+ * @brief Ищет неистекшую запись для домена.
+ *
+ * Каждое попадание увеличивает счетчик обращений записи. Если включено фоновое
+ * обновление, запись набрала не меньше `min_hits` обращений и до ее истечения
+ * осталось не больше `window` секунд, домен ставится в очередь на повторное
+ * разрешение, а вызывающему по-прежнему возвращается текущая запись.
+ *
+ * @param domain Имя домена.
+ * @param record Буфер для копии записи.
+ * @return 1, если запись найдена, 0 - если ее нет или она истекла.
+ */
+int domain_cache_get(const char *domain, DomainCacheRecord *record);
+
+/**
+ * @brief Добавляет или обновляет запись.
+ *
+ * Если кэш заполнен, новая запись занимает место истекшей или той, что
+ * истекает раньше других (среди нескольких ближайших), поэтому вытеснение не
+ * зависит от снимков и `domain_cache_purge_expired`.
+ *
+ * @param domain Имя домена.
+ * @param ips IP-адреса через пробел, как их возвращает `get_dns_info`.
+ * @param country_code Код страны или пустая строка.
+ * @param ttl Время жизни записи в секундах.
+ */
+void domain_cache_put(const char *domain, const char *ips, const char *country_code, unsigned int ttl);
+
+/**
+ * @brief Заполняет запись кэша из строки адресов (без добавления в кэш).
+ *
+ * @param domain Имя домена.
+ * @param ips IP-адреса через пробел.
+ * @param country_code Код страны или пустая строка.
+ * @param ttl Время жизни записи в секундах.
+ * @param record Запись для заполнения.
+ * @return 0 при успехе, -1 если имя домена слишком длинное.
+ */
+int domain_cache_make_record(const char *domain, const char *ips, const char *country_code, unsigned int ttl,
+                             DomainCacheRecord *record);
+
+/**
+ * @brief Добавляет или обновляет готовую запись (например, полученную из общего кэша).
+ *
+ * @param record Запись кэша.
+ */
+void domain_cache_put_record(const DomainCacheRecord *record);
+
+/**
+ * @brief Вызывает `fn` для каждой неистекшей записи (под блокировкой на чтение).
+ *
+ * @param fn Функция, вызываемая для каждой записи. Не должна обращаться к кэшу на запись.
+ * @param arg Аргумент для `fn`.
+ */
+void domain_cache_foreach(void (*fn)(const DomainCacheRecord *record, void *arg), void *arg);
+
+/**
+ * @brief Удаляет истекшие записи.
+ *
+ * @return Количество удаленных записей.
+ */
+size_t domain_cache_purge_expired(void);
+
+/**
+ * @brief Форматирует адреса записи в строку через пробел (как `get_dns_info`).
+ *
+ * @param record Запись кэша.
+ * @param ips Буфер для строки.
+ * @param ips_size Размер буфера.
+ */
+void domain_cache_format_ips(const DomainCacheRecord *record, char *ips, size_t ips_size);
+
+/**
+ * @brief Атомарно записывает снимок кэша (через временный файл и rename).
+ *
+ * @param path Путь к файлу снимка.
+ * @return Количество записанных записей или -1 при ошибке.
+ */
+long domain_cache_save(const char *path);
+
+/**
+ * @brief Записывает снимок кэша в открытый дескриптор с текущей позиции.
+ *
+ * Используется для передачи теплого кэша новому процессу через memfd.
+ *
+ * @param fd Дескриптор, открытый на запись.
+ * @return Количество записанных записей или -1 при ошибке.
+ */
+long domain_cache_save_fd(int fd);
+
+/**
+ * @brief Загружает снимок через mmap, пропуская истекшие записи.
+ *
+ * Файл с другой сигнатурой, версией или размером записи игнорируется.
+ *
+ * @param path Путь к файлу снимка.
+ * @return Количество загруженных записей или -1, если снимок не прочитан.
+ */
+long domain_cache_load(const char *path);
+
+/**
+ * @brief Загружает снимок из открытого дескриптора (файл или memfd) через mmap.
+ *
+ * @param fd Дескриптор снимка.
+ * @param name Имя снимка для сообщений об ошибках.
+ * @return Количество загруженных записей или -1, если снимок не прочитан.
+ */
+long domain_cache_load_fd(int fd, const char *name);
+
+/**
+ * @brief Запускает фоновый поток, периодически сохраняющий снимок.
+ *
+ * @param path Путь к файлу снимка.
+ * @param interval Период в секундах.
+ * @return 0 при успехе, -1 при ошибке.
+ */
+int domain_cache_start_snapshots(const char *path, unsigned int interval);
+
+/**
+ * @brief Останавливает фоновый поток и, если `save_final`, сохраняет финальный снимок.
+ *
+ * @param save_final 0, если снимок уже ведет другой процесс (после передачи сокета).
+ */
+void domain_cache_stop_snapshots(int save_final);
+
+/**
+ * @brief Включает фоновое обновление популярных записей (stale-while-revalidate).
+ *
+ * @param window За сколько секунд до истечения запись считается кандидатом на обновление (0 - выключено).
+ * @param min_hits Минимум обращений с момента последнего обновления.
+ * @param fn Функция повторного разрешения домена.
+ * @param arg Аргумент для `fn`.
+ * @return 0 при успехе, -1 при ошибке запуска потока.
+ */
+int domain_cache_start_refresher(unsigned int window, unsigned int min_hits, DomainRefreshFn fn, void *arg);
+
+/**
+ * @brief Останавливает поток фонового обновления.
+ */
+void domain_cache_stop_refresher(void);
+
+#endif // DOMAIN_CACHE_H
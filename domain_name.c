@@ -0,0 +1,166 @@
+#include <stdint.h>
+#include <string.h>
+
+#include "domain_name.h"
+
+#if defined(__x86_64__) || (defined(__i386__) && defined(__SSE2__))
+#include <immintrin.h>
+#define DOMAIN_NAME_X86 1
+#endif
+
+#define DOT_WORDS ((DOMAIN_NAME_MAX + 63) / 64) /**< Слов в битовой маске точек. */
+
+/**
+ * @brief Канонический байт имени или 0 для недопустимого байта.
+ */
+static unsigned char canonical_byte(unsigned char c)
+{
+    if ((c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') || c == '-' || c == '.')
+        return c;
+    if (c >= 'A' && c <= 'Z')
+        return c | 0x20;
+    return 0;
+}
+
+/**
+ * @brief Побайтовый проход с позиции `from` до `len`.
+ *
+ * @return 0 или -1, если встретился недопустимый байт.
+ */
+static int sweep_scalar(const unsigned char *in, size_t from, size_t len, unsigned char *out, uint64_t *dots)
+{
+    for (size_t i = from; i < len; i++)
+    {
+        unsigned char c = canonical_byte(in[i]);
+        if (c == 0)
+            return -1;
+        out[i] = c;
+        if (c == '.')
+            dots[i / 64] |= (uint64_t)1 << (i % 64);
+    }
+    return 0;
+}
+
+#ifdef DOMAIN_NAME_X86
+
+/**
+ * @brief Проход по 16 байт (SSE2 есть на любом x86-64).
+ *
+ * Сравнения знаковые, поэтому байты от 0x80 не попадают ни в один диапазон.
+ *
+ * @return Сколько байт обработано или -1, если встретился недопустимый байт.
+ */
+static long sweep_sse2(const unsigned char *in, size_t from, size_t len, unsigned char *out, uint64_t *dots)
+{
+    size_t i = from;
+
+    for (; i + 16 <= len; i += 16)
+    {
+        __m128i v = _mm_loadu_si128((const __m128i *)(in + i));
+        __m128i upper = _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8('A' - 1)), _mm_cmplt_epi8(v, _mm_set1_epi8('Z' + 1)));
+        __m128i lower = _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8('a' - 1)), _mm_cmplt_epi8(v, _mm_set1_epi8('z' + 1)));
+        __m128i digit = _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8('0' - 1)), _mm_cmplt_epi8(v, _mm_set1_epi8('9' + 1)));
+        __m128i dot = _mm_cmpeq_epi8(v, _mm_set1_epi8('.'));
+        __m128i hyphen = _mm_cmpeq_epi8(v, _mm_set1_epi8('-'));
+        __m128i valid = _mm_or_si128(_mm_or_si128(_mm_or_si128(upper, lower), digit), _mm_or_si128(dot, hyphen));
+
+        if (_mm_movemask_epi8(valid) != 0xFFFF)
+            return -1;
+
+        _mm_storeu_si128((__m128i *)(out + i), _mm_add_epi8(v, _mm_and_si128(upper, _mm_set1_epi8(0x20))));
+        dots[i / 64] |= (uint64_t)(unsigned)_mm_movemask_epi8(dot) << (i % 64);
+    }
+    return (long)(i - from);
+}
+
+/**
+ * @brief Тот же проход по 32 байта; вызывается, только если процессор умеет AVX2.
+ */
+__attribute__((target("avx2"))) static long sweep_avx2(const unsigned char *in, size_t len, unsigned char *out,
+                                                        uint64_t *dots)
+{
+    size_t i = 0;
+
+    for (; i + 32 <= len; i += 32)
+    {
+        __m256i v = _mm256_loadu_si256((const __m256i *)(in + i));
+        __m256i upper = _mm256_and_si256(_mm256_cmpgt_epi8(v, _mm256_set1_epi8('A' - 1)),
+                                         _mm256_cmpgt_epi8(_mm256_set1_epi8('Z' + 1), v));
+        __m256i lower = _mm256_and_si256(_mm256_cmpgt_epi8(v, _mm256_set1_epi8('a' - 1)),
+                                         _mm256_cmpgt_epi8(_mm256_set1_epi8('z' + 1), v));
+        __m256i digit = _mm256_and_si256(_mm256_cmpgt_epi8(v, _mm256_set1_epi8('0' - 1)),
+                                         _mm256_cmpgt_epi8(_mm256_set1_epi8('9' + 1), v));
+        __m256i dot = _mm256_cmpeq_epi8(v, _mm256_set1_epi8('.'));
+        __m256i hyphen = _mm256_cmpeq_epi8(v, _mm256_set1_epi8('-'));
+        __m256i valid = _mm256_or_si256(_mm256_or_si256(_mm256_or_si256(upper, lower), digit),
+                                        _mm256_or_si256(dot, hyphen));
+
+        if ((unsigned)_mm256_movemask_epi8(valid) != 0xFFFFFFFFu)
+            return -1;
+
+        _mm256_storeu_si256((__m256i *)(out + i), _mm256_add_epi8(v, _mm256_and_si256(upper, _mm256_set1_epi8(0x20))));
+        dots[i / 64] |= (uint64_t)(unsigned)_mm256_movemask_epi8(dot) << (i % 64);
+    }
+    return (long)i;
+}
+
+#endif
+
+/**
+ * @brief Проверяет метку [start, end) канонического имени.
+ */
+static int valid_label(const char *name, size_t start, size_t end)
+{
+    size_t len = end - start;
+
+    return len >= 1 && len <= DOMAIN_LABEL_MAX && name[start] != '-' && name[end - 1] != '-';
+}
+
+int domain_canonicalize(const char *input, size_t len, char *out)
+{
+    const unsigned char *in = (const unsigned char *)input;
+    unsigned char *dst = (unsigned char *)out;
+    uint64_t dots[DOT_WORDS] = {0};
+    size_t done = 0;
+
+    // Полностью определенное имя (с точкой корня) - то же имя
+    if (len > 0 && in[len - 1] == '.')
+        len--;
+    if (len == 0 || len > DOMAIN_NAME_MAX)
+        return -1;
+
+#ifdef DOMAIN_NAME_X86
+    long swept;
+
+    if (__builtin_cpu_supports("avx2"))
+    {
+        if ((swept = sweep_avx2(in, len, dst, dots)) < 0)
+            return -1;
+        done += swept;
+    }
+    if ((swept = sweep_sse2(in, done, len, dst, dots)) < 0)
+        return -1;
+    done += swept;
+#endif
+
+    if (sweep_scalar(in, done, len, dst, dots) < 0)
+        return -1;
+    out[len] = '\0';
+
+    // Метки проверяем по маске точек, не перечитывая имя побайтово
+    size_t start = 0;
+    for (size_t word = 0; word < DOT_WORDS; word++)
+    {
+        for (uint64_t bits = dots[word]; bits != 0; bits &= bits - 1)
+        {
+            size_t dot = word * 64 + __builtin_ctzll(bits);
+            if (!valid_label(out, start, dot))
+                return -1;
+            start = dot + 1;
+        }
+    }
+    if (!valid_label(out, start, len))
+        return -1;
+
+    return (int)len;
+}
@@ -0,0 +1,28 @@
+#ifndef DOMAIN_NAME_H
+#define DOMAIN_NAME_H
+
+#include <stddef.h>
+
+#define DOMAIN_NAME_MAX 253 /**< Максимальная длина имени без завершающей точки. */
+#define DOMAIN_LABEL_MAX 63 /**< Максимальная длина метки между точками. */
+
+/**
+ * @brief Проверяет имя хоста и приводит его к канонической форме.
+ *
+ * За один проход векторными инструкциями (AVX2 или SSE2, на остальных
+ * архитектурах - побайтово) проверяет, что имя состоит только из латинских
+ * букв, цифр, `-` и `.`, переводит буквы в нижний регистр и отмечает точки.
+ * Затем по маске точек проверяются метки: от 1 до DOMAIN_LABEL_MAX байт, без
+ * `-` в начале и в конце. Одна завершающая точка отбрасывается, поэтому
+ * `Example.COM.` и `example.com` дают один и тот же ключ кэша.
+ *
+ * Результат безопасно подставлять в командную строку `dig`.
+ *
+ * @param input Имя (не обязательно завершенное нулем).
+ * @param len Длина имени в байтах.
+ * @param out Буфер не меньше DOMAIN_NAME_MAX + 1 байт для канонического имени.
+ * @return Длина канонического имени или -1, если имя некорректно.
+ */
+int domain_canonicalize(const char *input, size_t len, char *out);
+
+#endif // DOMAIN_NAME_H
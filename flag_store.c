@@ -0,0 +1,246 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <ctype.h>
+
+#include "flag_store.h"
+
+#define FLAG_CACHE_CONTROL "public, max-age=31536000, immutable"
+
+static const char RESPONSE_NOT_FOUND[] =
+    "HTTP/1.1 404 Not Found\r\n"
+    "Content-Length: 0\r\n"
+    "Access-Control-Allow-Origin: *\r\n"
+    "Connection: close\r\n"
+    "\r\n";
+
+static FlagImage *images = NULL;
+static size_t image_count = 0;
+
+/**
+ * @brief Значение символа base64 или -1 для недопустимого символа.
+ */
+static int base64_value(unsigned char c)
+{
+    if (c >= 'A' && c <= 'Z')
+        return c - 'A';
+    if (c >= 'a' && c <= 'z')
+        return c - 'a' + 26;
+    if (c >= '0' && c <= '9')
+        return c - '0' + 52;
+    if (c == '+')
+        return 62;
+    if (c == '/')
+        return 63;
+    return -1;
+}
+
+/**
+ * @brief Декодирует строку base64 (выравнивание `=` и прочие символы пропускаются).
+ *
+ * @param text Строка base64.
+ * @param out_len Длина результата.
+ * @return Буфер, выделенный через malloc, или NULL.
+ */
+static unsigned char *base64_decode(const char *text, size_t *out_len)
+{
+    size_t len = strlen(text);
+    unsigned char *out = malloc(len / 4 * 3 + 3);
+    uint32_t acc = 0;
+    int bits = 0;
+    size_t n = 0;
+
+    if (out == NULL)
+        return NULL;
+
+    for (const unsigned char *p = (const unsigned char *)text; *p; p++)
+    {
+        int value = base64_value(*p);
+        if (value < 0)
+            continue;
+
+        acc = (acc << 6) | value;
+        bits += 6;
+        if (bits >= 8)
+        {
+            bits -= 8;
+            out[n++] = (acc >> bits) & 0xFF;
+        }
+    }
+
+    *out_len = n;
+    return out;
+}
+
+/**
+ * @brief Хеш FNV-1a содержимого изображения для ETag.
+ */
+static uint64_t hash_bytes(const unsigned char *data, size_t len)
+{
+    uint64_t hash = 1469598103934665603ULL;
+    for (size_t i = 0; i < len; i++)
+    {
+        hash ^= data[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+/**
+ * @brief Собирает готовые ответы 200 и 304 для изображения.
+ */
+static int build_responses(FlagImage *image)
+{
+    char headers[512];
+    int headers_len = snprintf(headers, sizeof(headers),
+                               "HTTP/1.1 200 OK\r\n"
+                               "Content-Type: image/png\r\n"
+                               "Content-Length: %zu\r\n"
+                               "ETag: %s\r\n"
+                               "Cache-Control: " FLAG_CACHE_CONTROL "\r\n"
+                               "Access-Control-Allow-Origin: *\r\n"
+                               "Connection: close\r\n"
+                               "\r\n",
+                               image->png_len, image->etag);
+
+    image->response_ok = malloc(headers_len + image->png_len);
+    if (image->response_ok == NULL)
+        return -1;
+    memcpy(image->response_ok, headers, headers_len);
+    memcpy(image->response_ok + headers_len, image->png, image->png_len);
+    image->response_ok_len = headers_len + image->png_len;
+
+    headers_len = snprintf(headers, sizeof(headers),
+                           "HTTP/1.1 304 Not Modified\r\n"
+                           "ETag: %s\r\n"
+                           "Cache-Control: " FLAG_CACHE_CONTROL "\r\n"
+                           "Access-Control-Allow-Origin: *\r\n"
+                           "Connection: close\r\n"
+                           "\r\n",
+                           image->etag);
+    image->response_not_modified = strdup(headers);
+    if (image->response_not_modified == NULL)
+        return -1;
+    image->response_not_modified_len = headers_len;
+
+    return 0;
+}
+
+int flag_store_init(const Flag *flags, size_t count)
+{
+    images = calloc(count, sizeof(FlagImage));
+    if (images == NULL)
+        return -1;
+    image_count = count;
+
+    for (size_t i = 0; i < count; i++)
+    {
+        FlagImage *image = &images[i];
+
+        image->flag = &flags[i];
+        image->png = base64_decode(flags[i].flag_img, &image->png_len);
+        if (image->png == NULL)
+        {
+            flag_store_destroy();
+            return -1;
+        }
+
+        snprintf(image->etag, sizeof(image->etag), "\"%016llx\"",
+                 (unsigned long long)hash_bytes(image->png, image->png_len));
+
+        if (build_responses(image) < 0)
+        {
+            flag_store_destroy();
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+void flag_store_destroy(void)
+{
+    for (size_t i = 0; i < image_count; i++)
+    {
+        free(images[i].png);
+        free(images[i].response_ok);
+        free(images[i].response_not_modified);
+    }
+    free(images);
+    images = NULL;
+    image_count = 0;
+}
+
+const FlagImage *flag_store_find(const char *code)
+{
+    for (size_t i = 0; i < image_count; i++)
+    {
+        if (strcmp(images[i].flag->key, code) == 0)
+            return &images[i];
+    }
+    return NULL;
+}
+
+/**
+ * @brief Проверяет, совпадает ли `If-None-Match` запроса с ETag изображения.
+ */
+static int etag_matches(const char *request, const char *etag)
+{
+    const char *header = strcasestr(request, "\nIf-None-Match:");
+    if (header == NULL)
+        return 0;
+
+    header += strlen("\nIf-None-Match:");
+    size_t value_len = strcspn(header, "\r\n");
+
+    // Значение может быть списком ETag через запятую или "*"
+    for (const char *p = header; p < header + value_len; p++)
+    {
+        if (*p == '*')
+            return 1;
+        if (*p == '"' && (size_t)(header + value_len - p) >= strlen(etag) && strncmp(p, etag, strlen(etag)) == 0)
+            return 1;
+    }
+    return 0;
+}
+
+char *flag_store_response(const char *request, const char *path, size_t *response_len)
+{
+    const char *source = RESPONSE_NOT_FOUND;
+    size_t source_len = sizeof(RESPONSE_NOT_FOUND) - 1;
+    char code[3];
+
+    // Ожидаем ровно /flag/XX.png (путь заканчивается после .png, strchr находит и нулевой байт), регистр кода не важен
+    path += strlen(FLAG_URL_PREFIX);
+    if (isalpha((unsigned char)path[0]) && isalpha((unsigned char)path[1]) && strncmp(path + 2, ".png", 4) == 0 &&
+        strchr(" ?\r\n", path[6]) != NULL)
+    {
+        code[0] = toupper((unsigned char)path[0]);
+        code[1] = toupper((unsigned char)path[1]);
+        code[2] = '\0';
+
+        const FlagImage *image = flag_store_find(code);
+        if (image != NULL && etag_matches(request, image->etag))
+        {
+            source = image->response_not_modified;
+            source_len = image->response_not_modified_len;
+        }
+        else if (image != NULL)
+        {
+            source = image->response_ok;
+            source_len = image->response_ok_len;
+        }
+    }
+
+    char *response = malloc(source_len);
+    if (response == NULL)
+    {
+        perror("malloc");
+        return NULL;
+    }
+    memcpy(response, source, source_len);
+    *response_len = source_len;
+    return response;
+}
@@ -0,0 +1,73 @@
+#ifndef FLAG_STORE_H
+#define FLAG_STORE_H
+
+#include <stddef.h>
+
+#include "flag_type.h"
+
+#define FLAG_URL_PREFIX "/flag/" /**< Путь, по которому отдаются изображения флагов. */
+
+/**
+ * @brief Как отдавать флаг страны в JSON-ответе.
+ */
+typedef enum
+{
+    FLAG_MODE_INLINE, /**< Поле `flagImg` с изображением в base64. */
+    FLAG_MODE_URL     /**< Поле `flagUrl` со ссылкой на `/flag/<ISO>.png`. */
+} FlagMode;
+
+/**
+ * @brief Флаг, декодированный в PNG, с готовыми HTTP-ответами.
+ */
+typedef struct
+{
+    const Flag *flag;                 /**< Исходная запись из flags.h. */
+    unsigned char *png;               /**< Двоичное изображение PNG. */
+    size_t png_len;                   /**< Размер изображения. */
+    char etag[24];                    /**< Сильный ETag в кавычках (хеш содержимого). */
+    char *response_ok;                /**< Полный ответ 200 с заголовками и изображением. */
+    size_t response_ok_len;           /**< Длина ответа 200. */
+    char *response_not_modified;      /**< Полный ответ 304. */
+    size_t response_not_modified_len; /**< Длина ответа 304. */
+} FlagImage;
+
+/**
+ * @brief Декодирует base64-изображения всех флагов один раз при запуске.
+ *
+ * Для каждого флага заранее собираются ответы 200 (с `ETag` и
+ * `Cache-Control: immutable`) и 304, так что при запросе остается только
+ * скопировать готовые байты.
+ *
+ * @param flags Массив флагов.
+ * @param count Количество флагов.
+ * @return 0 при успехе, -1 при ошибке выделения памяти.
+ */
+int flag_store_init(const Flag *flags, size_t count);
+
+/**
+ * @brief Освобождает декодированные изображения.
+ */
+void flag_store_destroy(void);
+
+/**
+ * @brief Ищет изображение по коду страны.
+ *
+ * @param code Код страны ISO 3166-1 (две буквы).
+ * @return Изображение или NULL, если флага нет (или хранилище не инициализировано).
+ */
+const FlagImage *flag_store_find(const char *code);
+
+/**
+ * @brief Обрабатывает запрос `GET /flag/<ISO>.png`.
+ *
+ * Если заголовок `If-None-Match` содержит ETag изображения (или `*`),
+ * возвращается 304 без тела. Для неизвестного кода возвращается 404.
+ *
+ * @param request Полный текст запроса, завершенный нулем.
+ * @param path Путь из строки запроса (начинается с `/flag/`) внутри `request`.
+ * @param response_len Длина ответа.
+ * @return Ответ, выделенный через malloc (освобождает вызывающий), или NULL.
+ */
+char *flag_store_response(const char *request, const char *path, size_t *response_len);
+
+#endif // FLAG_STORE_H
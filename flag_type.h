@@ -0,0 +1,12 @@
+#ifndef FLAG_TYPE_H
+#define FLAG_TYPE_H
+
+// Структура для хранения флагов
+typedef struct
+{
+    const char *key;
+    const char *flag_img;
+    const char *name;
+} Flag;
+
+#endif // FLAG_TYPE_H
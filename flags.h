@@ -247,13 +247,7 @@ const char YE[] = "iVBORw0KGgoAAAANSUhEUgAAABAAAAAMCAYAAABr5z2BAAABYElEQVQokaWRv
 const char ZM[] = "iVBORw0KGgoAAAANSUhEUgAAABAAAAAMCAYAAABr5z2BAAABaElEQVQokW2SvW5TQRSEv10v+UFJQ4WMFZBAriioQKLlIVKkR7RIPEQa3oE2b5EOgWhprCDxkwg3JCDHguu9O0Ox1/JNnGJ1jrQ7M9852vD47fbzts37Kn5Wiu5aDnac2/5hhRObCSV8CY5ni5zPJQYxplEpeqqi/TA+xHEbSOAAMqiAMqgFLWqNDViQXd+NWygXkFRgcLteWmCACGxASBA3IRh2G3g5hfsRZnP4nODdRmcgrY5VKSywu95wkeBwCMNLGCV4vwvtd0hSh9wTXqldv3ce2cwwacTJb3g9hAfzGwjW0gUY3hxv8eQs8eLnjGlrDl7BpO0ISh+/J0YrgnqMDQAulfzGHfRFLMfpidcNeiZeJl8zqFQrB2tpcD1dK4O1EfoGfYL8C9SAcycECN1/iMAA/rWmketugNNZDU2YT77kKGY+LiKnYUEB7gRxz+ahxBjx6NtfjQaZnVwxpl//8GHnFkf/ARpZQ/yv5dQeAAAAAElFTkSuQmCC";
 const char ZW[] = "iVBORw0KGgoAAAANSUhEUgAAABAAAAAMCAYAAABr5z2BAAACEklEQVQokWXSQYiUdRjH8c/7zju7M/YyawvCotusOpWXhSRModNe6iDkIYItOnXNk/eOS4Ed7ORhrx5i6aYogbQo1EFX3FZpN8JoM8e2aZl1Jlt1Z97/38MrYvSD3+Hh4ffwfR6epP5J/e1BPpiNRTwWQpiIRUzSmP4bQ/wjCckdwS+J5NdU2h4MB11PVLJKNhlCOBqGYTb5av5M/HLpCxOtjok6tZTNbe71WN+i2MEQxTMHRCRM10nW1tZio5H76er73nlzqWxGz/Vzlzs9Nh+x/oC8yv6cI3v4+y7J6upqfG183MN+3+L8SW99f1lSI9vLSJORA1Qnqe4hrZXDdzbYXuHKN2QxRt2/vhYX2mbe+8ylm4Xm4qJxpM8onkNlxEgoyvp3JDfOnYtj355UnRnzyoerttFqtXQ7HXtxEE1MlHkRXfyIG8hGDx/W7b+hsv6PqTx36dQps52OTdzFGq74v/bjOJJbKyvxQJqqT025ePq0fXNzRv33lkNsoI86xvASVjKyEKN8etoP382bOT6n8UG556DN499K79xnd4fBFiqMTrLrEL2XSZaXl+PDJ1uu33yX2pDIrgrNnNYYBxtUkxeQYvkLDx7z+QWyXq/no7Mf+3MwLFlfZE8YyZjaTbNBLSvD97e43WbYJznx6Yml8+3zC6LrCvc8Uhg1rrBPoSV4XfAqJgW5IAo2RNcUFp4CbGHjpyUQvQgAAAAASUVORK5CYII=";
 
-// Структура для хранения флагов
-typedef struct
-{
-    const char *key;
-    const char *flag_img;
-    const char *name;
-} Flag;
+#include "flag_type.h"
 
 Flag flags[] = {
     {"AF", AF, "Afghanistan (AF)"},
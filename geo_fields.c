@@ -0,0 +1,313 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <pthread.h>
+#include <arpa/inet.h>
+#include <json-c/json.h>
+
+#include "geo_fields.h"
+
+/** Путь MMDB, завершенный NULL. */
+#define PATH(...) ((const char *const[]){__VA_ARGS__, NULL})
+
+/**
+ * @brief Значение, которое читается от вложенного объекта группы.
+ */
+typedef struct
+{
+    const char *key;         /**< Ключ в JSON-ответе. */
+    const char *const *path; /**< Путь от объекта группы. */
+} GeoLeaf;
+
+/**
+ * @brief Группа полей: путь к вложенному объекту и значения внутри него.
+ */
+typedef struct
+{
+    unsigned int field;
+    const char *name;          /**< Имя в параметре `fields=`. */
+    const char *const *prefix; /**< Путь к объекту группы (NULL - сама запись). */
+    const GeoLeaf *leaves;
+    size_t leaf_count;
+} GeoGroup;
+
+static const GeoLeaf city_leaves[] = {
+    {"city", PATH("names", "en")},
+};
+
+static const GeoLeaf subdivision_leaves[] = {
+    {"subdivision", PATH("names", "en")},
+    {"subdivisionCode", PATH("iso_code")},
+};
+
+static const GeoLeaf location_leaves[] = {
+    {"latitude", PATH("latitude")},
+    {"longitude", PATH("longitude")},
+    {"accuracyRadius", PATH("accuracy_radius")},
+    {"timeZone", PATH("time_zone")},
+};
+
+static const GeoLeaf postal_leaves[] = {
+    {"postalCode", PATH("code")},
+};
+
+static const GeoLeaf continent_leaves[] = {
+    {"continentCode", PATH("code")},
+    {"continent", PATH("names", "en")},
+};
+
+static const GeoLeaf asn_leaves[] = {
+    {"asn", PATH("autonomous_system_number")},
+    {"asOrganization", PATH("autonomous_system_organization")},
+};
+
+#define LEAVES(array) array, sizeof(array) / sizeof(array[0])
+
+/** Группы в порядке вывода в ответе. */
+static const GeoGroup groups[] = {
+    {GEO_FIELD_CITY, "city", PATH("city"), LEAVES(city_leaves)},
+    {GEO_FIELD_SUBDIVISION, "subdivision", PATH("subdivisions", "0"), LEAVES(subdivision_leaves)},
+    {GEO_FIELD_LOCATION, "location", PATH("location"), LEAVES(location_leaves)},
+    {GEO_FIELD_POSTAL, "postal", PATH("postal"), LEAVES(postal_leaves)},
+    {GEO_FIELD_CONTINENT, "continent", PATH("continent"), LEAVES(continent_leaves)},
+    {GEO_FIELD_ASN, "asn", NULL, LEAVES(asn_leaves)},
+};
+
+#define GROUP_COUNT (sizeof(groups) / sizeof(groups[0]))
+
+/**
+ * @brief Готовый фрагмент для сети базы. `fields == 0` означает пустой слот.
+ */
+typedef struct
+{
+    uint32_t network;
+    unsigned int prefix;
+    unsigned int fields;
+    size_t len;
+    char fragment[GEO_FIELDS_FRAGMENT_MAX];
+} CacheEntry;
+
+static pthread_key_t cache_key;
+static pthread_once_t cache_key_once = PTHREAD_ONCE_INIT;
+static __thread CacheEntry *cache = NULL;
+
+static void free_cache(void *ptr)
+{
+    free(ptr);
+}
+
+static void create_cache_key(void)
+{
+    pthread_key_create(&cache_key, free_cache);
+}
+
+/**
+ * @brief Кэш вызывающего потока; создается при первом обращении.
+ */
+static CacheEntry *thread_cache(void)
+{
+    if (cache == NULL)
+    {
+        pthread_once(&cache_key_once, create_cache_key);
+        cache = calloc(GEO_FIELDS_CACHE_ENTRIES, sizeof(CacheEntry));
+        if (cache != NULL)
+            pthread_setspecific(cache_key, cache);
+    }
+    return cache;
+}
+
+int geo_fields_parse(const char *list, size_t len, unsigned int *fields)
+{
+    size_t pos = 0;
+
+    *fields = 0;
+    while (pos < len)
+    {
+        size_t name_len = 0;
+        while (pos + name_len < len && list[pos + name_len] != ',')
+            name_len++;
+
+        // Пустые элементы (`city,,asn` или запятая в конце) пропускаем
+        if (name_len > 0)
+        {
+            size_t i;
+            for (i = 0; i < GROUP_COUNT; i++)
+            {
+                if (strlen(groups[i].name) == name_len && memcmp(groups[i].name, list + pos, name_len) == 0)
+                    break;
+            }
+            if (i == GROUP_COUNT)
+                return -1;
+            *fields |= groups[i].field;
+        }
+        pos += name_len + 1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Дописывает в буфер по формату.
+ *
+ * @return 0 или -1, если не хватило места.
+ */
+static int append(char *out, size_t out_size, size_t *len, const char *format, ...)
+{
+    va_list args;
+
+    va_start(args, format);
+    int written = vsnprintf(out + *len, out_size - *len, format, args);
+    va_end(args);
+
+    if (written < 0 || (size_t)written >= out_size - *len)
+        return -1;
+    *len += written;
+    return 0;
+}
+
+/**
+ * @brief Дописывает `,"key": <значение>`; отсутствующее значение - `null`.
+ */
+static int append_value(char *out, size_t out_size, size_t *len, const char *key, const MMDB_entry_data_s *data)
+{
+    if (append(out, out_size, len, ",\"%s\": ", key) < 0)
+        return -1;
+
+    if (data == NULL || !data->has_data)
+        return append(out, out_size, len, "null");
+
+    switch (data->type)
+    {
+    case MMDB_DATA_TYPE_UTF8_STRING:
+    {
+        struct json_object *json = json_object_new_string_len(data->utf8_string, (int)data->data_size);
+        int status = append(out, out_size, len, "%s", json_object_to_json_string(json));
+        json_object_put(json);
+        return status;
+    }
+    case MMDB_DATA_TYPE_DOUBLE:
+        return append(out, out_size, len, "%.4f", data->double_value);
+    case MMDB_DATA_TYPE_FLOAT:
+        return append(out, out_size, len, "%.4f", (double)data->float_value);
+    case MMDB_DATA_TYPE_UINT16:
+        return append(out, out_size, len, "%u", (unsigned int)data->uint16);
+    case MMDB_DATA_TYPE_UINT32:
+        return append(out, out_size, len, "%u", (unsigned int)data->uint32);
+    case MMDB_DATA_TYPE_INT32:
+        return append(out, out_size, len, "%d", (int)data->int32);
+    case MMDB_DATA_TYPE_UINT64:
+        return append(out, out_size, len, "%llu", (unsigned long long)data->uint64);
+    case MMDB_DATA_TYPE_BOOLEAN:
+        return append(out, out_size, len, "%s", data->boolean ? "true" : "false");
+    default:
+        return append(out, out_size, len, "null");
+    }
+}
+
+/**
+ * @brief Формирует фрагмент по найденной записи (NULL - адрес не найден).
+ */
+static int format_record(MMDB_entry_s *record, unsigned int fields, char *out, size_t out_size)
+{
+    size_t len = 0;
+
+    out[0] = '\0';
+    for (size_t i = 0; i < GROUP_COUNT; i++)
+    {
+        const GeoGroup *group = &groups[i];
+        if ((fields & group->field) == 0)
+            continue;
+
+        // Вложенный объект группы ищем один раз, значения читаем уже от него
+        MMDB_entry_s base;
+        int have = record != NULL;
+        if (have)
+        {
+            base = *record;
+            if (group->prefix != NULL)
+            {
+                MMDB_entry_data_s object;
+                have = MMDB_aget_value(record, &object, group->prefix) == MMDB_SUCCESS && object.has_data &&
+                       object.type == MMDB_DATA_TYPE_MAP;
+                if (have)
+                    base.offset = object.offset;
+            }
+        }
+
+        for (size_t j = 0; j < group->leaf_count; j++)
+        {
+            MMDB_entry_data_s value;
+            int found = have && MMDB_aget_value(&base, &value, group->leaves[j].path) == MMDB_SUCCESS;
+            if (append_value(out, out_size, &len, group->leaves[j].key, found ? &value : NULL) < 0)
+                return -1;
+        }
+    }
+    return (int)len;
+}
+
+/**
+ * @brief Слот кэша для сети и набора полей.
+ */
+static CacheEntry *cache_slot(uint32_t network, unsigned int prefix, unsigned int fields)
+{
+    CacheEntry *entries = thread_cache();
+
+    if (entries == NULL)
+        return NULL;
+
+    uint64_t hash = ((uint64_t)network << 16 | (uint64_t)prefix << 8 | fields) * 0x9E3779B97F4A7C15ULL;
+    return &entries[(hash >> 32) & (GEO_FIELDS_CACHE_ENTRIES - 1)];
+}
+
+int geo_fields_format(const MMDB_s *mmdb, const char *ip, unsigned int fields, char *out, size_t out_size)
+{
+    struct in_addr addr;
+    int gai_error, mmdb_error;
+
+    if (fields == 0)
+    {
+        out[0] = '\0';
+        return 0;
+    }
+
+    if (ip[0] == '\0' || inet_pton(AF_INET, ip, &addr) != 1)
+        return format_record(NULL, fields, out, out_size);
+
+    MMDB_lookup_result_s result = MMDB_lookup_string(mmdb, ip, &gai_error, &mmdb_error);
+    if (gai_error != 0 || mmdb_error != MMDB_SUCCESS || !result.found_entry)
+        return format_record(NULL, fields, out, out_size);
+
+    // В базе IPv6 адреса IPv4 лежат под ::/96, длина префикса считается от нее
+    unsigned int prefix = result.netmask;
+    if (mmdb->metadata.ip_version == 6)
+        prefix = prefix >= 96 ? prefix - 96 : 0;
+    if (prefix > 32)
+        prefix = 32;
+    uint32_t network = prefix == 0 ? 0 : ntohl(addr.s_addr) & (UINT32_MAX << (32 - prefix));
+
+    CacheEntry *slot = cache_slot(network, prefix, fields);
+    if (slot != NULL && slot->fields == fields && slot->network == network && slot->prefix == prefix &&
+        slot->len < out_size)
+    {
+        memcpy(out, slot->fragment, slot->len);
+        out[slot->len] = '\0';
+        return (int)slot->len;
+    }
+
+    // Фрагмент ограничен GEO_FIELDS_FRAGMENT_MAX независимо от буфера, чтобы он всегда попадал в кэш.
+    // Значения записи не поместились - отдаем все поля как null, а не молча выбрасываем их
+    size_t limit = out_size > GEO_FIELDS_FRAGMENT_MAX ? GEO_FIELDS_FRAGMENT_MAX + 1 : out_size;
+    int len = format_record(&result.entry, fields, out, limit);
+    if (len < 0)
+        len = format_record(NULL, fields, out, out_size);
+    if (len >= 0 && slot != NULL && (size_t)len <= sizeof(slot->fragment))
+    {
+        slot->network = network;
+        slot->prefix = prefix;
+        slot->fields = fields;
+        slot->len = len;
+        memcpy(slot->fragment, out, len);
+    }
+    return len;
+}
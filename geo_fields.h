@@ -0,0 +1,61 @@
+#ifndef GEO_FIELDS_H
+#define GEO_FIELDS_H
+
+#include <stddef.h>
+#include <maxminddb.h>
+
+#define GEO_FIELDS_CACHE_ENTRIES 256 /**< Слотов кэша фрагментов на поток. */
+#define GEO_FIELDS_FRAGMENT_MAX 768  /**< Максимальная длина JSON-фрагмента с полями. */
+
+/**
+ * @brief Группы полей, которые можно запросить параметром `fields=`.
+ *
+ * Каждая группа соответствует одному вложенному объекту записи MMDB (для `asn` -
+ * полям верхнего уровня записи).
+ */
+typedef enum
+{
+    GEO_FIELD_CITY = 1 << 0,        /**< `city`: название города. */
+    GEO_FIELD_SUBDIVISION = 1 << 1, /**< `subdivision`: регион и его код. */
+    GEO_FIELD_LOCATION = 1 << 2,    /**< `location`: координаты, радиус точности, часовой пояс. */
+    GEO_FIELD_POSTAL = 1 << 3,      /**< `postal`: почтовый индекс. */
+    GEO_FIELD_CONTINENT = 1 << 4,   /**< `continent`: код и название континента. */
+    GEO_FIELD_ASN = 1 << 5,         /**< `asn`: номер и организация автономной системы. */
+} GeoField;
+
+/**
+ * @brief Разбирает список полей вида `city,location,asn`.
+ *
+ * @param list Список (не обязательно завершенный нулем).
+ * @param len Длина списка в байтах.
+ * @param fields Маска запрошенных групп (`GeoField`).
+ * @return 0 или -1, если в списке есть неизвестное поле.
+ */
+int geo_fields_parse(const char *list, size_t len, unsigned int *fields);
+
+/**
+ * @brief Формирует JSON-фрагмент с запрошенными полями для IP-адреса.
+ *
+ * Пути к полям записи заранее разложены по группам: для каждой запрошенной группы
+ * вложенный объект находится один раз, а затем от него читаются только нужные
+ * значения. Запись целиком (`MMDB_get_entry_data_list`) не декодируется.
+ *
+ * Все адреса одной сети базы получают одну и ту же запись, поэтому готовый
+ * фрагмент кэшируется по сети (адрес и длина префикса из результата поиска) и
+ * набору полей. Кэш свой у каждого потока и не берет блокировок.
+ *
+ * Фрагмент начинается с запятой: `,"city": "Berlin","latitude": 52.5244`. Поля,
+ * которых нет в записи, и все поля для ненайденного адреса выводятся как `null`.
+ * Если значения записи не помещаются в буфер или в GEO_FIELDS_FRAGMENT_MAX байт
+ * (например, слишком длинное название), все запрошенные поля тоже выводятся как `null`.
+ *
+ * @param mmdb Открытая база MaxMind.
+ * @param ip IPv4-адрес или пустая строка.
+ * @param fields Маска запрошенных групп.
+ * @param out Буфер для фрагмента.
+ * @param out_size Размер буфера `out` (достаточно GEO_FIELDS_FRAGMENT_MAX + 1).
+ * @return Длина фрагмента или -1, если в буфер не поместились даже значения `null`.
+ */
+int geo_fields_format(const MMDB_s *mmdb, const char *ip, unsigned int fields, char *out, size_t out_size);
+
+#endif // GEO_FIELDS_H
@@ -3,10 +3,15 @@
 #include <string.h>
 #include <maxminddb.h>
 
+#include "probes.h"
+
 char *print_entry_data(MMDB_entry_data_s *entry_data, int *iso_code);
 void print_entry_data_list(MMDB_entry_data_list_s *entry_data_list);
 char *get_country_from_ip(const char *ip_address, MMDB_s mmdb);
 
+/** Печатать ли диагностические сообщения (в пакетном режиме отключается). */
+int geo_lookup_verbose = 1;
+
 /**
  * Получает информацию о стране по IP-адресу и возвращает её как строку.
  *
@@ -28,6 +33,8 @@ char *get_country_from_ip(const char *ip_address, MMDB_s mmdb)
     char *country_info = NULL;
     int iso_code = 0;
 
+    PROBE1(country__start, ip_address);
+
     // Выполняем поиск по IP-адресу
     lookup_result = MMDB_lookup_string(&mmdb, ip_address, &gai_error, &mmdb_error);
 
@@ -52,17 +59,21 @@ char *get_country_from_ip(const char *ip_address, MMDB_s mmdb)
                 }
                 current_entry_data = current_entry_data->next;
             }
+
+            // Освобождаем список, строка страны уже скопирована
+            MMDB_free_entry_data_list(entry_data);
         }
-        else
+        else if (geo_lookup_verbose)
         {
-            printf("Ошибка при получении данных: %s\n", MMDB_strerror(status));
+            fprintf(stderr, "Ошибка при получении данных: %s\n", MMDB_strerror(status));
         }
     }
-    else
+    else if (geo_lookup_verbose)
     {
-        printf("IP-адрес не найден в базе данных.\n");
+        fprintf(stderr, "IP-адрес не найден в базе данных.\n");
     }
-    
+
+    PROBE2(country__done, ip_address, country_info != NULL ? country_info : "");
     return country_info;
 }
 
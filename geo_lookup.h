@@ -3,6 +3,13 @@
 
 #include <maxminddb.h>
 
+/**
+ * Флаг вывода диагностических сообщений модуля в stderr.
+ *
+ * По умолчанию включен; пакетный режим отключает его, чтобы не засорять вывод.
+ */
+extern int geo_lookup_verbose;
+
 /**
  * Получает информацию о стране по IP-адресу и возвращает её как строку.
  *
@@ -13,6 +20,7 @@
  * @param {MMDB_s} mmdb - Структура базы данных MaxMind, предварительно открытая.
  *
  * @return {char *} - Возвращает строку с информацией о стране или NULL в случае ошибки.
+ *                    Строка выделяется через malloc и должна быть освобождена вызывающим.
  */
 char *get_country_from_ip(const char *ip_address, MMDB_s mmdb);
 
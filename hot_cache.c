@@ -0,0 +1,112 @@
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+
+#include "hot_cache.h"
+
+/**
+ * @brief Слот горячего кэша. `hash == 0` означает пустой слот.
+ */
+typedef struct
+{
+    uint64_t hash;
+    int64_t valid_until;       /**< До какого момента отдавать запись отсюда (Unix time). */
+    DomainCacheRecord record;
+} HotEntry;
+
+static size_t slot_count = 0;         /**< Степень двойки или 0, если кэш выключен. */
+static unsigned int hot_refresh_window = 0;
+static pthread_key_t table_key;
+static pthread_once_t table_key_once = PTHREAD_ONCE_INIT;
+static __thread HotEntry *table = NULL;
+
+static void free_table(void *ptr)
+{
+    free(ptr);
+}
+
+static void create_table_key(void)
+{
+    pthread_key_create(&table_key, free_table);
+}
+
+/**
+ * @brief FNV-1a, как и в кэше доменов (0 зарезервирован под пустой слот).
+ */
+static uint64_t hash_domain(const char *domain)
+{
+    uint64_t hash = 1469598103934665603ULL;
+
+    for (const unsigned char *p = (const unsigned char *)domain; *p != '\0'; p++)
+    {
+        hash ^= *p;
+        hash *= 1099511628211ULL;
+    }
+    return hash != 0 ? hash : 1;
+}
+
+/**
+ * @brief Таблица вызывающего потока; создается при первом обращении.
+ */
+static HotEntry *thread_table(void)
+{
+    if (table == NULL && slot_count > 0)
+    {
+        pthread_once(&table_key_once, create_table_key);
+        table = calloc(slot_count, sizeof(HotEntry));
+        if (table != NULL)
+            pthread_setspecific(table_key, table);
+    }
+    return table;
+}
+
+void hot_cache_configure(size_t entries, unsigned int refresh_window)
+{
+    size_t count = 1;
+
+    if (entries == 0)
+    {
+        slot_count = 0;
+        return;
+    }
+    while (count < entries)
+        count <<= 1;
+    slot_count = count;
+    hot_refresh_window = refresh_window;
+}
+
+int hot_cache_get(const char *domain, DomainCacheRecord *record)
+{
+    HotEntry *entries = thread_table();
+
+    if (entries == NULL)
+        return 0;
+
+    uint64_t hash = hash_domain(domain);
+    const HotEntry *entry = &entries[hash & (slot_count - 1)];
+    if (entry->hash != hash || entry->valid_until <= time(NULL) || strcmp(entry->record.domain, domain) != 0)
+        return 0;
+
+    *record = entry->record;
+    return 1;
+}
+
+void hot_cache_put(const DomainCacheRecord *record)
+{
+    HotEntry *entries = thread_table();
+
+    if (entries == NULL)
+        return;
+
+    // Запись, которой осталось меньше окна обновления, сюда не попадает
+    int64_t valid_until = record->expires_at - (int64_t)hot_refresh_window;
+    if (valid_until <= time(NULL))
+        return;
+
+    uint64_t hash = hash_domain(record->domain);
+    HotEntry *entry = &entries[hash & (slot_count - 1)];
+    entry->hash = hash;
+    entry->valid_until = valid_until;
+    entry->record = *record;
+}
@@ -0,0 +1,41 @@
+#ifndef HOT_CACHE_H
+#define HOT_CACHE_H
+
+#include <stddef.h>
+
+#include "domain_cache.h"
+
+#define HOT_CACHE_DEFAULT_ENTRIES 1024 /**< Слотов на поток по умолчанию (около 320 КБ - в пределах L2). */
+
+/**
+ * @brief Включает горячий кэш для всех потоков процесса.
+ *
+ * Горячий кэш - небольшая таблица с прямым отображением перед кэшем доменов.
+ * У каждого потока своя таблица: она создается при первом обращении потока,
+ * поэтому в шарде, привязанном к ядру, память выделяется на узле NUMA этого
+ * ядра, а чтение не берет ни блокировок, ни атомарных операций. Вызывается до
+ * запуска потоков, которые будут им пользоваться.
+ *
+ * Записи живут не дольше `expires_at - refresh_window`: последние секунды
+ * жизни запросы снова идут в кэш доменов и считаются для фонового обновления.
+ *
+ * @param entries Количество слотов на поток (0 - выключить).
+ * @param refresh_window Окно фонового обновления кэша доменов в секундах.
+ */
+void hot_cache_configure(size_t entries, unsigned int refresh_window);
+
+/**
+ * @brief Ищет домен в горячем кэше потока.
+ *
+ * @param domain Имя домена.
+ * @param record Найденная запись.
+ * @return 1, если запись найдена и не устарела, иначе 0.
+ */
+int hot_cache_get(const char *domain, DomainCacheRecord *record);
+
+/**
+ * @brief Кладет запись в горячий кэш потока, вытесняя запись из того же слота.
+ */
+void hot_cache_put(const DomainCacheRecord *record);
+
+#endif // HOT_CACHE_H
@@ -0,0 +1,243 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+
+#include "peer_limit.h"
+#include "admission.h"
+
+/**
+ * @brief Ведро токенов и счетчики одного uid.
+ */
+typedef struct
+{
+    int used;
+    PeerLimitRule rule;
+    double tokens;
+    uint64_t refilled_at; /**< Момент последнего пополнения (admission_now_ms). */
+    unsigned long admitted;
+    unsigned long limited;
+} PeerSlot;
+
+/**
+ * @brief Раскладка общей области памяти ограничителя.
+ */
+typedef struct
+{
+    pthread_mutex_t lock; /**< Межпроцессный robust-мьютекс всей таблицы. */
+    size_t rule_count;
+    PeerLimitRule rules[PEER_LIMIT_MAX_RULES];
+    PeerSlot slots[PEER_LIMIT_MAX_PEERS];
+} PeerRegion;
+
+static PeerRegion *region = NULL;
+
+int peer_limit_parse(const char *spec, PeerLimitRule *rule)
+{
+    char *end;
+
+    memset(rule, 0, sizeof(*rule));
+    if (spec[0] == '*')
+    {
+        rule->uid = PEER_ANY_UID;
+        end = (char *)spec + 1;
+    }
+    else
+    {
+        rule->uid = (uid_t)strtoul(spec, &end, 10);
+        if (end == spec)
+            return -1;
+    }
+
+    if (*end != ':')
+        return -1;
+    rule->rate = strtod(end + 1, &end);
+    rule->burst = rule->rate < 1.0 ? 1.0 : rule->rate;
+    rule->weight = 1;
+
+    if (*end == ':')
+        rule->burst = strtod(end + 1, &end);
+    if (*end == ':')
+        rule->weight = (unsigned int)strtoul(end + 1, &end, 10);
+
+    if (*end != '\0' || rule->rate < 0.0 || rule->burst < 1.0 || rule->weight < 1)
+        return -1;
+    return 0;
+}
+
+/**
+ * @brief Захватывает мьютекс таблицы, восстанавливая его после падения владельца.
+ */
+static void lock_region(void)
+{
+    if (pthread_mutex_lock(&region->lock) == EOWNERDEAD)
+        pthread_mutex_consistent(&region->lock);
+}
+
+int peer_limit_init(const PeerLimitRule *rules, size_t count)
+{
+    pthread_mutexattr_t attr;
+
+    if (count == 0)
+        return 0;
+    if (count > PEER_LIMIT_MAX_RULES)
+        count = PEER_LIMIT_MAX_RULES;
+
+    region = mmap(NULL, sizeof(PeerRegion), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (region == MAP_FAILED)
+    {
+        perror("mmap");
+        region = NULL;
+        return -1;
+    }
+
+    // Анонимное отображение заполнено нулями, так что все слоты пусты
+    region->rule_count = count;
+    memcpy(region->rules, rules, count * sizeof(PeerLimitRule));
+
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+    pthread_mutexattr_setrobust(&attr, PTHREAD_MUTEX_ROBUST);
+    pthread_mutex_init(&region->lock, &attr);
+    pthread_mutexattr_destroy(&attr);
+
+    return 0;
+}
+
+void peer_limit_destroy(void)
+{
+    if (region != NULL)
+        munmap(region, sizeof(PeerRegion));
+    region = NULL;
+}
+
+int peer_limit_enabled(void)
+{
+    return region != NULL;
+}
+
+/**
+ * @brief Правило для uid: свое, иначе `*`, иначе без ограничения скорости с весом 1.
+ */
+static PeerLimitRule find_rule(uid_t uid)
+{
+    PeerLimitRule rule = {uid, 0.0, 1.0, 1};
+
+    for (size_t i = 0; i < region->rule_count; i++)
+    {
+        if (region->rules[i].uid == uid)
+            return region->rules[i];
+        if (region->rules[i].uid == PEER_ANY_UID)
+            rule = region->rules[i];
+    }
+    rule.uid = uid;
+    return rule;
+}
+
+/**
+ * @brief Находит или занимает слот uid (вызывается под мьютексом).
+ */
+static int find_slot(uid_t uid, uint64_t now)
+{
+    int last = PEER_LIMIT_MAX_PEERS - 1;
+
+    for (int i = 0; i < last; i++)
+    {
+        PeerSlot *slot = &region->slots[i];
+
+        if (slot->used && slot->rule.uid == uid)
+            return i;
+        if (!slot->used)
+        {
+            slot->used = 1;
+            slot->rule = find_rule(uid);
+            slot->tokens = slot->rule.burst;
+            slot->refilled_at = now;
+            return i;
+        }
+    }
+
+    // Таблица заполнена: остальные uid делят последний слот с правилом `*`
+    PeerSlot *slot = &region->slots[last];
+    if (!slot->used)
+    {
+        slot->used = 1;
+        slot->rule = find_rule(PEER_ANY_UID);
+        slot->tokens = slot->rule.burst;
+        slot->refilled_at = now;
+    }
+    return last;
+}
+
+int peer_limit_admit(int client_sock, PeerInfo *peer)
+{
+    struct ucred cred;
+    socklen_t len = sizeof(cred);
+    uint64_t now = admission_now_ms();
+    int admitted = 1;
+
+    // Без SO_PEERCRED (не Unix-сокет) клиент попадает в общий слот
+    if (getsockopt(client_sock, SOL_SOCKET, SO_PEERCRED, &cred, &len) < 0)
+    {
+        cred.uid = PEER_ANY_UID;
+        cred.pid = 0;
+    }
+    peer->uid = cred.uid;
+    peer->pid = cred.pid;
+
+    lock_region();
+    peer->slot = find_slot(cred.uid, now);
+    PeerSlot *slot = &region->slots[peer->slot];
+    peer->weight = slot->rule.weight;
+
+    if (slot->rule.rate > 0.0)
+    {
+        slot->tokens += (double)(now - slot->refilled_at) * slot->rule.rate / 1000.0;
+        if (slot->tokens > slot->rule.burst)
+            slot->tokens = slot->rule.burst;
+        slot->refilled_at = now;
+
+        if (slot->tokens >= 1.0)
+            slot->tokens -= 1.0;
+        else
+            admitted = 0;
+    }
+
+    if (admitted)
+        slot->admitted++;
+    else
+        slot->limited++;
+    pthread_mutex_unlock(&region->lock);
+
+    return admitted;
+}
+
+size_t peer_limit_get_stats(PeerStats *stats)
+{
+    size_t count = 0;
+
+    if (region == NULL)
+        return 0;
+
+    lock_region();
+    for (int i = 0; i < PEER_LIMIT_MAX_PEERS; i++)
+    {
+        const PeerSlot *slot = &region->slots[i];
+        if (!slot->used)
+            continue;
+
+        stats[count].uid = i == PEER_LIMIT_MAX_PEERS - 1 ? PEER_ANY_UID : slot->rule.uid;
+        stats[count].weight = slot->rule.weight;
+        stats[count].rate = slot->rule.rate;
+        stats[count].admitted = slot->admitted;
+        stats[count].limited = slot->limited;
+        count++;
+    }
+    pthread_mutex_unlock(&region->lock);
+
+    return count;
+}
@@ -0,0 +1,98 @@
+#ifndef PEER_LIMIT_H
+#define PEER_LIMIT_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+#define PEER_LIMIT_MAX_RULES 32 /**< Сколько правил `--peer-limit` можно задать. */
+#define PEER_LIMIT_MAX_PEERS 64 /**< Сколько uid учитываются по отдельности (остальные делят последний слот). */
+#define PEER_ANY_UID ((uid_t)-1) /**< uid правила `*` - для всех, у кого нет своего правила. */
+
+/**
+ * @brief Правило для uid: скорость, запас токенов и вес в очереди.
+ */
+typedef struct
+{
+    uid_t uid;           /**< uid клиента или PEER_ANY_UID. */
+    double rate;         /**< Запросов в секунду (0 - без ограничения скорости). */
+    double burst;        /**< Емкость ведра токенов (сколько запросов можно сделать залпом). */
+    unsigned int weight; /**< Вес в справедливой очереди: доля обслуживания пропорциональна весу. */
+} PeerLimitRule;
+
+/**
+ * @brief Клиент соединения, определенный через SO_PEERCRED.
+ */
+typedef struct
+{
+    uid_t uid;           /**< uid процесса клиента. */
+    pid_t pid;           /**< pid процесса клиента. */
+    int slot;            /**< Номер слота uid (0..PEER_LIMIT_MAX_PEERS-1) для справедливой очереди. */
+    unsigned int weight; /**< Вес клиента в справедливой очереди. */
+} PeerInfo;
+
+/**
+ * @brief Счетчики одного uid для `/stats`.
+ */
+typedef struct
+{
+    uid_t uid;              /**< uid (PEER_ANY_UID - общий слот для не поместившихся). */
+    unsigned int weight;    /**< Вес. */
+    double rate;            /**< Ограничение скорости (0 - нет). */
+    unsigned long admitted; /**< Пропущенные соединения. */
+    unsigned long limited;  /**< Соединения, получившие 429. */
+} PeerStats;
+
+/**
+ * @brief Разбирает правило вида `UID:RATE[:BURST[:WEIGHT]]` (UID может быть `*`).
+ *
+ * По умолчанию BURST равен RATE (но не меньше 1), WEIGHT - 1.
+ *
+ * @param spec Текст правила.
+ * @param rule Результат.
+ * @return 0 при успехе, -1 при ошибке формата.
+ */
+int peer_limit_parse(const char *spec, PeerLimitRule *rule);
+
+/**
+ * @brief Включает ограничение по клиентам с заданными правилами.
+ *
+ * Ведра токенов и счетчики размещаются в общей памяти (MAP_SHARED) с
+ * межпроцессным robust-мьютексом, поэтому функция вызывается до fork рабочих
+ * процессов, и ограничение скорости действует на сервер в целом. Без правил
+ * ограничение выключено, и соединения не проверяются вовсе.
+ *
+ * @param rules Массив правил.
+ * @param count Количество правил (0 - выключено).
+ * @return 0 при успехе, -1 при ошибке.
+ */
+int peer_limit_init(const PeerLimitRule *rules, size_t count);
+
+/**
+ * @brief Освобождает общую память ограничителя.
+ */
+void peer_limit_destroy(void);
+
+/**
+ * @brief Проверяет, включено ли ограничение по клиентам.
+ */
+int peer_limit_enabled(void);
+
+/**
+ * @brief Определяет клиента соединения и забирает токен из его ведра.
+ *
+ * @param client_sock Принятое соединение.
+ * @param peer Клиент соединения (заполняется и при отказе).
+ * @return 1, если запрос пропущен, 0, если клиент превысил скорость.
+ */
+int peer_limit_admit(int client_sock, PeerInfo *peer);
+
+/**
+ * @brief Копирует счетчики по uid.
+ *
+ * @param stats Массив на PEER_LIMIT_MAX_PEERS элементов.
+ * @return Количество заполненных элементов.
+ */
+size_t peer_limit_get_stats(PeerStats *stats);
+
+#endif // PEER_LIMIT_H
@@ -0,0 +1,272 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <zlib.h>
+#include <json-c/json.h>
+
+#include "precompressed.h"
+
+#define GZIP_HEADER_SIZE 10
+#define GZIP_TRAILER_SIZE 8
+#define GZIP_MIN_SAVING 64 /**< Меньшая экономия не окупает заголовок, трейлер и сжатие префикса. */
+
+// Заголовок gzip: deflate, без имени файла и времени, ОС - Unix
+static const unsigned char gzip_header[GZIP_HEADER_SIZE] = {0x1f, 0x8b, 8, 0, 0, 0, 0, 0, 0, 3};
+
+static const Flag *flags_base = NULL;
+static size_t flags_count = 0;
+static ResponseFragment *fragments = NULL; /**< [флаг * 2 + режим], последний - "страна не найдена". */
+
+/**
+ * @brief Заполняет фрагмент: сохраняет текст и сжимает его в самостоятельный поток raw deflate.
+ */
+static int make_fragment(ResponseFragment *fragment, char *raw)
+{
+    z_stream stream;
+
+    fragment->raw = raw;
+    fragment->raw_len = strlen(raw);
+    fragment->crc = crc32(0L, (const Bytef *)raw, fragment->raw_len);
+
+    memset(&stream, 0, sizeof(stream));
+    if (deflateInit2(&stream, Z_BEST_COMPRESSION, Z_DEFLATED, -MAX_WBITS, 9, Z_DEFAULT_STRATEGY) != Z_OK)
+        return -1;
+
+    size_t bound = deflateBound(&stream, fragment->raw_len);
+    fragment->deflated = malloc(bound);
+    if (fragment->deflated == NULL)
+    {
+        deflateEnd(&stream);
+        return -1;
+    }
+
+    stream.next_in = (Bytef *)raw;
+    stream.avail_in = fragment->raw_len;
+    stream.next_out = fragment->deflated;
+    stream.avail_out = bound;
+    int status = deflate(&stream, Z_FINISH);
+    fragment->deflated_len = stream.total_out;
+    deflateEnd(&stream);
+
+    return status == Z_STREAM_END ? 0 : -1;
+}
+
+/**
+ * @brief Строит JSON-фрагмент после IP-адресов для флага в заданном режиме.
+ */
+static char *format_fragment(const Flag *flag, FlagMode mode)
+{
+    struct json_object *image;
+    struct json_object *name;
+    const char *image_key;
+    char *raw = NULL;
+
+    if (flag == NULL)
+        return strdup("}");
+
+    if (mode == FLAG_MODE_URL)
+    {
+        char flag_url[32];
+        snprintf(flag_url, sizeof(flag_url), FLAG_URL_PREFIX "%s.png", flag->key);
+        image = json_object_new_string(flag_url);
+        image_key = "flagUrl";
+    }
+    else
+    {
+        image = json_object_new_string(flag->flag_img);
+        image_key = "flagImg";
+    }
+    name = json_object_new_string(flag->name);
+
+    // Значения экранируются json-c так же, как при сборке всего ответа через json-c
+    if (asprintf(&raw, ",\"%s\": %s,\"countryName\": %s}", image_key,
+                 json_object_to_json_string(image), json_object_to_json_string(name)) < 0)
+        raw = NULL;
+
+    json_object_put(image);
+    json_object_put(name);
+    return raw;
+}
+
+int precompressed_init(const Flag *flags, size_t count)
+{
+    size_t total = count * 2 + 1;
+
+    fragments = calloc(total, sizeof(ResponseFragment));
+    if (fragments == NULL)
+        return -1;
+    flags_base = flags;
+    flags_count = count;
+
+    for (size_t i = 0; i < total; i++)
+    {
+        const Flag *flag = i < count * 2 ? &flags[i / 2] : NULL;
+        char *raw = format_fragment(flag, (FlagMode)(i % 2));
+
+        if (raw == NULL || make_fragment(&fragments[i], raw) < 0)
+        {
+            free(raw);
+            precompressed_destroy();
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+void precompressed_destroy(void)
+{
+    if (fragments != NULL)
+    {
+        for (size_t i = 0; i < flags_count * 2 + 1; i++)
+        {
+            free(fragments[i].raw);
+            free(fragments[i].deflated);
+        }
+    }
+    free(fragments);
+    fragments = NULL;
+    flags_base = NULL;
+    flags_count = 0;
+}
+
+const ResponseFragment *precompressed_fragment(const Flag *flag, FlagMode mode)
+{
+    if (fragments == NULL)
+        return NULL;
+
+    // Флаги приходят из того же массива, что был передан в precompressed_init
+    if (flag == NULL || flag < flags_base || flag >= flags_base + flags_count)
+        return &fragments[flags_count * 2];
+    return &fragments[(flag - flags_base) * 2 + (mode == FLAG_MODE_URL)];
+}
+
+ContentEncoding precompressed_negotiate(const char *request, const ResponseFragment *fragment)
+{
+    // Короткие ответы (страна не найдена, ссылка на флаг) от gzip только вырастут
+    if (fragment->deflated_len + GZIP_HEADER_SIZE + GZIP_TRAILER_SIZE + GZIP_MIN_SAVING > fragment->raw_len)
+        return ENCODING_IDENTITY;
+
+    const char *header = strcasestr(request, "\nAccept-Encoding:");
+    if (header == NULL)
+        return ENCODING_IDENTITY;
+
+    header += strlen("\nAccept-Encoding:");
+    size_t value_len = strcspn(header, "\r\n");
+
+    int gzip_refused = 0;
+    int any_accepted = 0;
+
+    // Перебираем элементы списка вида "gzip;q=0.8, br, *;q=0"
+    for (const char *item = header; item < header + value_len;)
+    {
+        size_t item_len = strcspn(item, ",\r\n");
+        if (item + item_len > header + value_len)
+            item_len = header + value_len - item;
+
+        while (item_len > 0 && (*item == ' ' || *item == '\t'))
+        {
+            item++;
+            item_len--;
+        }
+
+        size_t name_len = strcspn(item, ";, \t\r\n");
+        if (name_len > item_len)
+            name_len = item_len;
+
+        const char *q = memmem(item, item_len, "q=", 2);
+        int acceptable = q == NULL || strtod(q + 2, NULL) > 0.0;
+
+        if ((name_len == 4 && strncasecmp(item, "gzip", 4) == 0) ||
+            (name_len == 6 && strncasecmp(item, "x-gzip", 6) == 0))
+        {
+            if (acceptable)
+                return ENCODING_GZIP;
+            gzip_refused = 1;
+        }
+        else if (name_len == 1 && item[0] == '*' && acceptable)
+        {
+            any_accepted = 1;
+        }
+
+        item += item_len + 1;
+    }
+
+    // "*" разрешает gzip, только если он не запрещен явно
+    return any_accepted && !gzip_refused ? ENCODING_GZIP : ENCODING_IDENTITY;
+}
+
+/**
+ * @brief Поток для сжатия динамической части, свой у каждого потока выполнения.
+ *
+ * Инициализируется один раз и сбрасывается через deflateReset, чтобы не выделять
+ * окно сжатия на каждый запрос.
+ */
+static __thread z_stream prefix_stream;
+static __thread int prefix_stream_ready = 0;
+
+char *precompressed_body(const char *prefix, size_t prefix_len, const ResponseFragment *fragment,
+                         ContentEncoding encoding, size_t *body_len)
+{
+    char *body;
+
+    if (encoding == ENCODING_IDENTITY)
+    {
+        body = malloc(prefix_len + fragment->raw_len);
+        if (body == NULL)
+            return NULL;
+        memcpy(body, prefix, prefix_len);
+        memcpy(body + prefix_len, fragment->raw, fragment->raw_len);
+        *body_len = prefix_len + fragment->raw_len;
+        return body;
+    }
+
+    if (!prefix_stream_ready)
+    {
+        // Префикс короткий: быстрый уровень и минимальная хеш-таблица
+        if (deflateInit2(&prefix_stream, Z_BEST_SPEED, Z_DEFLATED, -MAX_WBITS, 1, Z_DEFAULT_STRATEGY) != Z_OK)
+            return NULL;
+        prefix_stream_ready = 1;
+    }
+    else
+    {
+        deflateReset(&prefix_stream);
+    }
+
+    // deflateBound рассчитан на Z_FINISH, для маркера Z_SYNC_FLUSH добавляем запас
+    size_t prefix_bound = deflateBound(&prefix_stream, prefix_len) + 16;
+    body = malloc(GZIP_HEADER_SIZE + prefix_bound + fragment->deflated_len + GZIP_TRAILER_SIZE);
+    if (body == NULL)
+        return NULL;
+
+    memcpy(body, gzip_header, GZIP_HEADER_SIZE);
+
+    // Z_SYNC_FLUSH завершает поток пустым блоком на границе байта, но не последним блоком
+    prefix_stream.next_in = (Bytef *)prefix;
+    prefix_stream.avail_in = prefix_len;
+    prefix_stream.next_out = (Bytef *)body + GZIP_HEADER_SIZE;
+    prefix_stream.avail_out = prefix_bound;
+    if (deflate(&prefix_stream, Z_SYNC_FLUSH) != Z_OK || prefix_stream.avail_in != 0)
+    {
+        free(body);
+        return NULL;
+    }
+
+    size_t len = GZIP_HEADER_SIZE + (prefix_bound - prefix_stream.avail_out);
+
+    // Сжатый фрагмент не ссылается на предыдущие данные, поэтому его можно просто дописать
+    memcpy(body + len, fragment->deflated, fragment->deflated_len);
+    len += fragment->deflated_len;
+
+    uLong crc = crc32_combine(crc32(0L, (const Bytef *)prefix, prefix_len), fragment->crc, fragment->raw_len);
+    uLong size = prefix_len + fragment->raw_len;
+    for (int i = 0; i < 4; i++)
+        body[len++] = (crc >> (8 * i)) & 0xFF;
+    for (int i = 0; i < 4; i++)
+        body[len++] = (size >> (8 * i)) & 0xFF;
+
+    *body_len = len;
+    return body;
+}
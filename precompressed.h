@@ -0,0 +1,81 @@
+#ifndef PRECOMPRESSED_H
+#define PRECOMPRESSED_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "flag_type.h"
+#include "flag_store.h"
+
+/**
+ * @brief Кодирование тела ответа, выбранное по `Accept-Encoding`.
+ */
+typedef enum
+{
+    ENCODING_IDENTITY, /**< Без сжатия. */
+    ENCODING_GZIP      /**< gzip. */
+} ContentEncoding;
+
+/**
+ * @brief Постоянная часть JSON-ответа для страны (все после IP-адресов).
+ *
+ * Хранится как есть и заранее сжатой в отдельный поток deflate, который
+ * приклеивается к сжатой на лету динамической части.
+ */
+typedef struct
+{
+    char *raw;               /**< Фрагмент JSON: `,"flagImg": ...,"countryName": ...}`. */
+    size_t raw_len;          /**< Длина фрагмента. */
+    unsigned char *deflated; /**< Фрагмент, сжатый в raw deflate с последним блоком. */
+    size_t deflated_len;     /**< Длина сжатого фрагмента. */
+    uint32_t crc;            /**< CRC-32 несжатого фрагмента (для трейлера gzip). */
+} ResponseFragment;
+
+/**
+ * @brief Готовит фрагменты ответов для всех стран в обоих режимах флага.
+ *
+ * @param flags Массив флагов.
+ * @param count Количество флагов.
+ * @return 0 при успехе, -1 при ошибке.
+ */
+int precompressed_init(const Flag *flags, size_t count);
+
+/**
+ * @brief Освобождает подготовленные фрагменты.
+ */
+void precompressed_destroy(void);
+
+/**
+ * @brief Возвращает фрагмент для флага (NULL - страна не найдена) и режима выдачи.
+ */
+const ResponseFragment *precompressed_fragment(const Flag *flag, FlagMode mode);
+
+/**
+ * @brief Выбирает кодирование по заголовку `Accept-Encoding` запроса.
+ *
+ * gzip выбирается, только если сжатие фрагмента заметно уменьшает ответ.
+ *
+ * @param request Полный текст запроса.
+ * @param fragment Постоянная часть тела.
+ * @return ENCODING_GZIP, если клиент принимает gzip (с q > 0) и сжатие выгодно, иначе ENCODING_IDENTITY.
+ */
+ContentEncoding precompressed_negotiate(const char *request, const ResponseFragment *fragment);
+
+/**
+ * @brief Собирает тело ответа из динамического префикса и готового фрагмента.
+ *
+ * Для gzip сжимается только префикс (с Z_SYNC_FLUSH, чтобы поток закончился на
+ * границе байта), затем дописывается заранее сжатый фрагмент, а CRC-32 трейлера
+ * получается объединением CRC префикса и фрагмента.
+ *
+ * @param prefix Динамическая часть тела.
+ * @param prefix_len Длина префикса.
+ * @param fragment Постоянная часть тела.
+ * @param encoding Кодирование.
+ * @param body_len Длина результата.
+ * @return Тело, выделенное через malloc (освобождает вызывающий), или NULL.
+ */
+char *precompressed_body(const char *prefix, size_t prefix_len, const ResponseFragment *fragment,
+                         ContentEncoding encoding, size_t *body_len);
+
+#endif // PRECOMPRESSED_H
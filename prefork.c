@@ -0,0 +1,156 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <signal.h>
+#include <time.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+#include "prefork.h"
+
+#define MIN_WORKER_UPTIME 1 /**< Процесс, проживший меньше (сек.), перезапускается с паузой. */
+
+/**
+ * @brief Состояние одного рабочего процесса.
+ */
+typedef struct
+{
+    pid_t pid;          /**< PID процесса (0 - не запущен). */
+    time_t started_at;  /**< Момент запуска. */
+    time_t restart_at;  /**< Когда можно перезапустить упавший процесс. */
+} WorkerSlot;
+
+/**
+ * @brief Запускает рабочий процесс в слоте.
+ */
+static int spawn_worker(WorkerSlot *slot, int id, WorkerMainFn worker_main, void *arg, const sigset_t *old_mask)
+{
+    pid_t pid = fork();
+
+    if (pid < 0)
+    {
+        perror("fork");
+        return -1;
+    }
+
+    if (pid == 0)
+    {
+        // В дочернем процессе возвращаем исходную маску сигналов: SIGTERM снова прерывает accept
+        sigprocmask(SIG_SETMASK, old_mask, NULL);
+        exit(worker_main(id, arg));
+    }
+
+    slot->pid = pid;
+    slot->started_at = time(NULL);
+    slot->restart_at = 0;
+    printf("Запущен рабочий процесс %d (pid %d)\n", id, (int)pid);
+    fflush(stdout);
+    return 0;
+}
+
+int prefork_run(int workers, WorkerMainFn worker_main, void *arg, unsigned int interval, MaintenanceFn maintenance,
+                UpgradeFn upgrade)
+{
+    WorkerSlot *slots = calloc(workers, sizeof(WorkerSlot));
+    sigset_t mask, old_mask;
+    time_t next_maintenance = interval > 0 ? time(NULL) + interval : 0;
+    int stopping = 0;
+    int handed_over = 0;
+    int alive = 0;
+
+    if (slots == NULL)
+    {
+        perror("calloc");
+        return -1;
+    }
+
+    // Мастер обрабатывает сигналы синхронно через sigtimedwait
+    sigemptyset(&mask);
+    sigaddset(&mask, SIGCHLD);
+    sigaddset(&mask, SIGINT);
+    sigaddset(&mask, SIGTERM);
+    sigaddset(&mask, SIGUSR2);
+    sigprocmask(SIG_BLOCK, &mask, &old_mask);
+
+    fflush(stdout);
+    for (int i = 0; i < workers; i++)
+    {
+        if (spawn_worker(&slots[i], i, worker_main, arg, &old_mask) == 0)
+            alive++;
+    }
+
+    // До остановки крутимся всегда: упавшие процессы перезапускаются по таймеру
+    while (!stopping || alive > 0)
+    {
+        struct timespec timeout = {1, 0};
+        int sig = sigtimedwait(&mask, NULL, &timeout);
+        time_t now = time(NULL);
+
+        // Сокет передан новой версии: рабочие дообслуживают свои соединения и выходят
+        if (sig == SIGUSR2 && !stopping && upgrade != NULL && upgrade(arg) == 0)
+        {
+            handed_over = 1;
+            sig = SIGTERM;
+        }
+
+        if ((sig == SIGINT || sig == SIGTERM) && !stopping)
+        {
+            stopping = 1;
+            printf("Остановка: рассылаем SIGTERM рабочим процессам\n");
+            fflush(stdout);
+            for (int i = 0; i < workers; i++)
+            {
+                if (slots[i].pid > 0)
+                    kill(slots[i].pid, SIGTERM);
+            }
+        }
+
+        // Собираем завершившиеся процессы
+        int status;
+        pid_t pid;
+        while ((pid = waitpid(-1, &status, WNOHANG)) > 0)
+        {
+            for (int i = 0; i < workers; i++)
+            {
+                if (slots[i].pid != pid)
+                    continue;
+
+                slots[i].pid = 0;
+                alive--;
+                if (!stopping)
+                {
+                    if (WIFSIGNALED(status))
+                        fprintf(stderr, "Рабочий процесс %d (pid %d) убит сигналом %d\n", i, (int)pid, WTERMSIG(status));
+                    else
+                        fprintf(stderr, "Рабочий процесс %d (pid %d) завершился с кодом %d\n", i, (int)pid, WEXITSTATUS(status));
+
+                    // Не перезапускаем мгновенно процесс, который падает сразу после старта
+                    slots[i].restart_at = now - slots[i].started_at < MIN_WORKER_UPTIME ? now + 1 : now;
+                }
+                break;
+            }
+        }
+
+        if (!stopping)
+        {
+            for (int i = 0; i < workers; i++)
+            {
+                if (slots[i].pid == 0 && slots[i].restart_at <= now &&
+                    spawn_worker(&slots[i], i, worker_main, arg, &old_mask) == 0)
+                    alive++;
+            }
+        }
+
+        if (maintenance != NULL && next_maintenance > 0 && now >= next_maintenance)
+        {
+            maintenance(arg);
+            next_maintenance = now + interval;
+        }
+    }
+
+    sigprocmask(SIG_SETMASK, &old_mask, NULL);
+    free(slots);
+    return handed_over;
+}
@@ -0,0 +1,45 @@
+#ifndef PREFORK_H
+#define PREFORK_H
+
+/**
+ * @brief Главная функция рабочего процесса.
+ *
+ * Вызывается в дочернем процессе после fork. Должна обслуживать соединения,
+ * пока не получит SIGTERM, и вернуть код завершения процесса.
+ */
+typedef int (*WorkerMainFn)(int worker_id, void *arg);
+
+/**
+ * @brief Периодическая задача мастер-процесса (например, запись снимка кэша).
+ */
+typedef void (*MaintenanceFn)(void *arg);
+
+/**
+ * @brief Передача слушающего сокета новой версии сервера (по SIGUSR2).
+ *
+ * @return 0, если новый процесс принял сокет, иначе -1.
+ */
+typedef int (*UpgradeFn)(void *arg);
+
+/**
+ * @brief Запускает `workers` рабочих процессов и следит за ними.
+ *
+ * Дочерние процессы наследуют открытый слушающий сокет и по очереди принимают
+ * соединения из него. Мастер перезапускает упавшие процессы (с паузой, если
+ * процесс упал сразу после запуска), раз в `interval` секунд вызывает
+ * `maintenance`, а по SIGINT/SIGTERM рассылает SIGTERM рабочим и ждет их завершения.
+ * По SIGUSR2 вызывается `upgrade`; если сокет передан, мастер останавливает рабочих
+ * так же, как по SIGTERM.
+ *
+ * @param workers Количество рабочих процессов.
+ * @param worker_main Функция рабочего процесса.
+ * @param arg Аргумент для `worker_main` и `maintenance`.
+ * @param interval Период вызова `maintenance` в секундах (0 - не вызывать).
+ * @param maintenance Периодическая задача мастера или NULL.
+ * @param upgrade Передача сокета новой версии или NULL.
+ * @return 0 после штатной остановки, 1 если сокет передан новой версии, -1 при ошибке.
+ */
+int prefork_run(int workers, WorkerMainFn worker_main, void *arg, unsigned int interval, MaintenanceFn maintenance,
+                UpgradeFn upgrade);
+
+#endif // PREFORK_H
@@ -0,0 +1,33 @@
+#ifndef PROBES_H
+#define PROBES_H
+
+/**
+ * @brief Статические точки трассировки USDT (провайдер `unix_server`).
+ *
+ * Если при сборке есть `<sys/sdt.h>` (пакет systemtap-sdt-dev или
+ * systemtap-sdt-devel), каждая точка - это одна инструкция `nop` и запись в
+ * секции `.note.stapsdt`: пока к ней не подключен bpftrace, perf или SystemTap,
+ * она ничего не стоит. Без заголовка или с `-DNO_PROBES` макросы пустые, а
+ * аргументы не вычисляются.
+ *
+ * Пары `*__start`/`*__done` позволяют мерить длительность стадий, например:
+ * `bpftrace -e 'usdt:./unix-server:unix_server:dns__start { @t[tid] = nsecs }
+ * usdt:./unix-server:unix_server:dns__done /@t[tid]/ { @ms = hist((nsecs - @t[tid]) / 1000000); delete(@t[tid]) }'`.
+ */
+
+#if !defined(NO_PROBES) && defined(__has_include)
+#if __has_include(<sys/sdt.h>)
+#include <sys/sdt.h>
+#define PROBES_ENABLED 1
+#endif
+#endif
+
+#ifdef PROBES_ENABLED
+#define PROBE1(name, a) DTRACE_PROBE1(unix_server, name, a)
+#define PROBE2(name, a, b) DTRACE_PROBE2(unix_server, name, a, b)
+#else
+#define PROBE1(name, a) do { (void)sizeof(a); } while (0)
+#define PROBE2(name, a, b) do { (void)sizeof(a); (void)sizeof(b); } while (0)
+#endif
+
+#endif // PROBES_H
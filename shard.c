@@ -0,0 +1,47 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <sched.h>
+
+#include "shard.h"
+
+int shard_cpu_count(void)
+{
+    cpu_set_t set;
+
+    if (sched_getaffinity(0, sizeof(set), &set) < 0)
+        return 1;
+
+    int count = CPU_COUNT(&set);
+    return count > 0 ? count : 1;
+}
+
+int shard_pin(int shard_id)
+{
+    cpu_set_t allowed, target;
+    int index;
+
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) < 0)
+    {
+        perror("sched_getaffinity");
+        return -1;
+    }
+
+    // Номер шарда отсчитываем по разрешенным ядрам: маска может быть с пропусками
+    index = shard_id % CPU_COUNT(&allowed);
+    for (int cpu = 0; cpu < CPU_SETSIZE; cpu++)
+    {
+        if (!CPU_ISSET(cpu, &allowed) || index-- > 0)
+            continue;
+
+        CPU_ZERO(&target);
+        CPU_SET(cpu, &target);
+        if (sched_setaffinity(0, sizeof(target), &target) < 0)
+        {
+            perror("sched_setaffinity");
+            return -1;
+        }
+        return cpu;
+    }
+
+    return -1;
+}
@@ -0,0 +1,28 @@
+#ifndef SHARD_H
+#define SHARD_H
+
+#define SHARDS_AUTO -1 /**< `--shards auto`: по шарду на каждое доступное ядро. */
+
+/**
+ * @brief Количество ядер, на которых процессу разрешено выполняться.
+ *
+ * Учитывает маску sched_getaffinity (taskset, cpuset контейнера), а не только
+ * число ядер в системе.
+ *
+ * @return Количество ядер (не меньше 1).
+ */
+int shard_cpu_count(void);
+
+/**
+ * @brief Привязывает вызывающий процесс к ядру шарда через sched_setaffinity.
+ *
+ * Шард `shard_id` получает `shard_id`-е по счету разрешенное ядро (по кругу,
+ * если шардов больше, чем ядер). Вызывается до создания потоков: они наследуют
+ * привязку, а память, которую шард затронет первым, ядро выделит на его узле NUMA.
+ *
+ * @param shard_id Номер шарда, начиная с 0.
+ * @return Номер ядра или -1 при ошибке (сообщение уже напечатано).
+ */
+int shard_pin(int shard_id);
+
+#endif // SHARD_H
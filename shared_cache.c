@@ -0,0 +1,264 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/mman.h>
+
+#include "shared_cache.h"
+
+/**
+ * @brief Шард таблицы.
+ */
+typedef struct
+{
+    pthread_mutex_t lock; /**< Межпроцессный robust-мьютекс шарда. */
+} SharedShard;
+
+/**
+ * @brief Слот таблицы. `hash == 0` означает пустой слот.
+ */
+typedef struct
+{
+    uint64_t hash;
+    DomainCacheRecord record;
+} SharedSlot;
+
+/**
+ * @brief Раскладка общей области памяти.
+ */
+typedef struct
+{
+    size_t slots_per_shard;
+    SharedShard shards[SHARED_CACHE_SHARDS];
+    SharedSlot slots[];
+} SharedRegion;
+
+static SharedRegion *region = NULL;
+static size_t region_size = 0;
+static int region_fd = -1;
+
+/**
+ * @brief Хеш FNV-1a имени домена (никогда не равен 0).
+ */
+static uint64_t hash_domain(const char *domain)
+{
+    uint64_t hash = 1469598103934665603ULL;
+    for (const unsigned char *p = (const unsigned char *)domain; *p; p++)
+    {
+        hash ^= *p;
+        hash *= 1099511628211ULL;
+    }
+    return hash | 1;
+}
+
+/**
+ * @brief Открывает анонимный файл для общей памяти.
+ */
+static int open_region_fd(void)
+{
+#ifdef MFD_CLOEXEC
+    int fd = memfd_create("unix-server-cache", MFD_CLOEXEC);
+    if (fd >= 0)
+        return fd;
+#endif
+    char name[64];
+    snprintf(name, sizeof(name), "/unix-server-cache-%d", (int)getpid());
+    int shm_fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0600);
+    if (shm_fd >= 0)
+        shm_unlink(name); // Имя больше не нужно, область живет, пока открыт дескриптор
+    return shm_fd;
+}
+
+/**
+ * @brief Захватывает мьютекс шарда, восстанавливая его после падения владельца.
+ */
+static void lock_shard(SharedShard *shard)
+{
+    if (pthread_mutex_lock(&shard->lock) == EOWNERDEAD)
+        pthread_mutex_consistent(&shard->lock);
+}
+
+int shared_cache_init(size_t entries)
+{
+    pthread_mutexattr_t attr;
+    size_t per_shard = (entries + SHARED_CACHE_SHARDS - 1) / SHARED_CACHE_SHARDS;
+
+    if (per_shard < SHARED_CACHE_PROBES)
+        per_shard = SHARED_CACHE_PROBES;
+
+    region_fd = open_region_fd();
+    if (region_fd < 0)
+    {
+        perror("memfd_create");
+        return -1;
+    }
+
+    region_size = sizeof(SharedRegion) + per_shard * SHARED_CACHE_SHARDS * sizeof(SharedSlot);
+    if (ftruncate(region_fd, region_size) < 0)
+    {
+        perror("ftruncate");
+        close(region_fd);
+        region_fd = -1;
+        return -1;
+    }
+
+    region = mmap(NULL, region_size, PROT_READ | PROT_WRITE, MAP_SHARED, region_fd, 0);
+    if (region == MAP_FAILED)
+    {
+        perror("mmap");
+        region = NULL;
+        close(region_fd);
+        region_fd = -1;
+        return -1;
+    }
+
+    // ftruncate заполняет файл нулями, так что все слоты уже пусты
+    region->slots_per_shard = per_shard;
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+    pthread_mutexattr_setrobust(&attr, PTHREAD_MUTEX_ROBUST);
+    for (int i = 0; i < SHARED_CACHE_SHARDS; i++)
+        pthread_mutex_init(&region->shards[i].lock, &attr);
+    pthread_mutexattr_destroy(&attr);
+
+    return 0;
+}
+
+void shared_cache_destroy(void)
+{
+    if (region != NULL)
+        munmap(region, region_size);
+    if (region_fd >= 0)
+        close(region_fd);
+    region = NULL;
+    region_fd = -1;
+}
+
+int shared_cache_enabled(void)
+{
+    return region != NULL;
+}
+
+int shared_cache_fd(void)
+{
+    return region_fd;
+}
+
+int shared_cache_get(const char *domain, DomainCacheRecord *record)
+{
+    uint64_t hash;
+    SharedShard *shard;
+    SharedSlot *slots;
+    size_t start;
+    int found = 0;
+
+    if (region == NULL)
+        return 0;
+
+    hash = hash_domain(domain);
+    shard = &region->shards[hash % SHARED_CACHE_SHARDS];
+    slots = region->slots + (hash % SHARED_CACHE_SHARDS) * region->slots_per_shard;
+    start = (hash / SHARED_CACHE_SHARDS) % region->slots_per_shard;
+
+    lock_shard(shard);
+    for (int i = 0; i < SHARED_CACHE_PROBES; i++)
+    {
+        SharedSlot *slot = &slots[(start + i) % region->slots_per_shard];
+        if (slot->hash == hash && strncmp(slot->record.domain, domain, sizeof(slot->record.domain)) == 0)
+        {
+            if (slot->record.expires_at > time(NULL))
+            {
+                *record = slot->record;
+                record->domain[sizeof(record->domain) - 1] = '\0';
+                found = 1;
+            }
+            break;
+        }
+    }
+    pthread_mutex_unlock(&shard->lock);
+
+    return found;
+}
+
+void shared_cache_put(const DomainCacheRecord *record)
+{
+    uint64_t hash;
+    SharedShard *shard;
+    SharedSlot *slots;
+    SharedSlot *same = NULL;
+    SharedSlot *free_slot = NULL;
+    SharedSlot *oldest = NULL;
+    size_t start;
+    int64_t now = time(NULL);
+
+    if (region == NULL)
+        return;
+
+    hash = hash_domain(record->domain);
+    shard = &region->shards[hash % SHARED_CACHE_SHARDS];
+    slots = region->slots + (hash % SHARED_CACHE_SHARDS) * region->slots_per_shard;
+    start = (hash / SHARED_CACHE_SHARDS) % region->slots_per_shard;
+
+    lock_shard(shard);
+    for (int i = 0; i < SHARED_CACHE_PROBES; i++)
+    {
+        SharedSlot *slot = &slots[(start + i) % region->slots_per_shard];
+
+        // Тот же домен - обновляем на месте
+        if (slot->hash == hash && strncmp(slot->record.domain, record->domain, sizeof(slot->record.domain)) == 0)
+        {
+            same = slot;
+            break;
+        }
+        if (slot->hash == 0 || slot->record.expires_at <= now)
+        {
+            if (free_slot == NULL)
+                free_slot = slot;
+        }
+        else if (oldest == NULL || slot->record.expires_at < oldest->record.expires_at)
+        {
+            oldest = slot;
+        }
+    }
+
+    // Иначе берем пустой или истекший слот, а если их нет - вытесняем тот, что истекает раньше всех
+    SharedSlot *target = same != NULL ? same : free_slot != NULL ? free_slot : oldest;
+    target->hash = hash;
+    target->record = *record;
+    pthread_mutex_unlock(&shard->lock);
+}
+
+void shared_cache_foreach(void (*fn)(const DomainCacheRecord *record, void *arg), void *arg)
+{
+    int64_t now = time(NULL);
+
+    if (region == NULL)
+        return;
+
+    for (int s = 0; s < SHARED_CACHE_SHARDS; s++)
+    {
+        SharedSlot *slots = region->slots + s * region->slots_per_shard;
+        for (size_t i = 0; i < region->slots_per_shard; i++)
+        {
+            DomainCacheRecord copy;
+            int live;
+
+            lock_shard(&region->shards[s]);
+            live = slots[i].hash != 0 && slots[i].record.expires_at > now;
+            if (live)
+                copy = slots[i].record;
+            pthread_mutex_unlock(&region->shards[s].lock);
+
+            if (live)
+            {
+                copy.domain[sizeof(copy.domain) - 1] = '\0';
+                fn(&copy, arg);
+            }
+        }
+    }
+}
@@ -0,0 +1,66 @@
+#ifndef SHARED_CACHE_H
+#define SHARED_CACHE_H
+
+#include <stddef.h>
+
+#include "domain_cache.h"
+
+#define SHARED_CACHE_SHARDS 64               /**< Количество шардов (у каждого свой мьютекс). */
+#define SHARED_CACHE_PROBES 8                /**< Длина линейного пробирования внутри шарда. */
+#define SHARED_CACHE_DEFAULT_ENTRIES 65536   /**< Емкость общего кэша по умолчанию. */
+
+/**
+ * @brief Создает общий для процессов кэш доменов в анонимной памяти `memfd`.
+ *
+ * Область отображается с MAP_SHARED до fork, поэтому все рабочие процессы видят
+ * одни и те же записи. Таблица разбита на шарды с межпроцессными robust-мьютексами:
+ * если процесс упадет, удерживая мьютекс, следующий владелец восстановит его.
+ * Если `memfd_create` недоступен, используется `shm_open`.
+ *
+ * @param entries Количество слотов.
+ * @return 0 при успехе, -1 при ошибке.
+ */
+int shared_cache_init(size_t entries);
+
+/**
+ * @brief Отключает процесс от общего кэша.
+ */
+void shared_cache_destroy(void);
+
+/**
+ * @brief Проверяет, создан ли общий кэш.
+ *
+ * @return 1, если общий кэш включен, иначе 0.
+ */
+int shared_cache_enabled(void);
+
+/**
+ * @brief Возвращает дескриптор memfd/shm с областью кэша (-1, если кэш не создан).
+ */
+int shared_cache_fd(void);
+
+/**
+ * @brief Ищет неистекшую запись домена в общем кэше.
+ *
+ * @param domain Имя домена.
+ * @param record Буфер для копии записи.
+ * @return 1, если запись найдена, иначе 0.
+ */
+int shared_cache_get(const char *domain, DomainCacheRecord *record);
+
+/**
+ * @brief Добавляет или обновляет запись. При заполненной цепочке вытесняет самую старую.
+ *
+ * @param record Запись кэша.
+ */
+void shared_cache_put(const DomainCacheRecord *record);
+
+/**
+ * @brief Вызывает `fn` для каждой неистекшей записи общего кэша.
+ *
+ * @param fn Функция, вызываемая для каждой записи (вне блокировки шарда, с копией записи).
+ * @param arg Аргумент для `fn`.
+ */
+void shared_cache_foreach(void (*fn)(const DomainCacheRecord *record, void *arg), void *arg);
+
+#endif // SHARED_CACHE_H
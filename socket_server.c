@@ -0,0 +1,673 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+
+#include "socket_server.h"
+#include "timer_wheel.h"
+#include "admission.h"
+#include "peer_limit.h"
+#include "probes.h"
+
+#define EVENT_BATCH 64
+#define DRAIN_TIMEOUT_MS 10000 /**< Сколько дообслуживать открытые соединения при остановке. */
+
+// Стоимость запроса в виртуальном времени справедливой очереди (делится на вес клиента)
+#define FAIR_QUEUE_COST 1048576
+
+/**
+ * @brief Стадия обслуживания соединения.
+ */
+typedef enum
+{
+    CONN_READ_HEADER, /**< Ждем заголовки (таймаут header). */
+    CONN_READ_BODY,   /**< Ждем тело по Content-Length (таймаут body). */
+    CONN_QUEUED,      /**< Запрос в очереди или у обработчика (без таймаута, действует дедлайн запроса). */
+    CONN_WRITE        /**< Отправляем ответ (таймаут write). */
+} ConnectionState;
+
+/**
+ * @brief Соединение с клиентом.
+ */
+typedef struct Connection
+{
+    TimerEntry timer;                  /**< Таймаут текущей стадии (первый член - для приведения типа). */
+    int fd;                            /**< Неблокирующий сокет клиента. */
+    ConnectionState state;             /**< Стадия обслуживания. */
+    char request[SOCKET_REQUEST_SIZE]; /**< Прочитанная часть запроса, завершенная нулем. */
+    size_t request_len;                /**< Длина прочитанной части. */
+    size_t request_total;              /**< Ожидаемая длина запроса: заголовки и тело. */
+    char *response;                    /**< Ответ (malloc). */
+    size_t response_len;               /**< Длина ответа. */
+    size_t sent;                       /**< Сколько байт ответа уже отправлено. */
+    uint64_t accepted_at;              /**< Момент accept (admission_now_ms), от него считается дедлайн. */
+    PeerInfo peer;                     /**< Клиент (только с --peer-limit). */
+    int rate_limited;                  /**< Клиент превысил скорость: вместо ответа - 429. */
+    int watched;                       /**< Сокет зарегистрирован в epoll. */
+    uint64_t finish;                   /**< Метка окончания в справедливой очереди. */
+    struct Connection *next_done;      /**< Следующее соединение с готовым ответом. */
+    struct Connection *prev_open;      /**< Соседи в списке открытых соединений. */
+    struct Connection *next_open;
+} Connection;
+
+/**
+ * @brief Ограниченная очередь запросов между потоком ввода-вывода и обработчиком.
+ */
+typedef struct
+{
+    pthread_mutex_t lock;
+    pthread_cond_t not_empty;
+    Connection **items;       /**< Кольцевой буфер на `capacity` элементов. */
+    unsigned int capacity;
+    unsigned int head;
+    unsigned int count;
+    int closing;              /**< Цикл остановлен: оставшиеся запросы не обрабатывать и выйти. */
+    int fair;                 /**< Справедливая очередь по uid вместо FIFO (включена с --peer-limit). */
+    uint64_t virtual_time;    /**< Метка последнего обслуженного запроса. */
+    uint64_t last_finish[PEER_LIMIT_MAX_PEERS]; /**< Метка последнего запроса каждого uid. */
+    Connection *done;         /**< Соединения с готовым ответом для потока ввода-вывода. */
+    int wake_fd;              /**< eventfd, будящий поток ввода-вывода. */
+    unsigned long wakeups;    /**< Записи в eventfd (системные вызовы обработчика). */
+    SocketResponseFn fn;
+    void *arg;
+} PendingQueue;
+
+/**
+ * @brief Состояние цикла ввода-вывода.
+ */
+typedef struct
+{
+    int epoll_fd;
+    int server_sock;
+    int accepting;                  /**< Слушающий сокет зарегистрирован в epoll. */
+    const ConnectionLimits *limits;
+    TimerWheel timers;
+    PendingQueue queue;
+    Connection *open_list;          /**< Все открытые соединения. */
+    unsigned long open;             /**< Их количество. */
+    unsigned long requests;         /**< Отправленные ответы. */
+    unsigned long syscalls;         /**< Системные вызовы потока ввода-вывода. */
+    unsigned long timeouts[3];      /**< Закрытые по таймауту: заголовки, тело, запись. */
+} SocketLoop;
+
+/**
+ * @brief Забирает следующий запрос из очереди (вызывается под мьютексом).
+ *
+ * Без ограничения по клиентам - FIFO. С ним - self-clocked fair queueing:
+ * выбирается запрос с наименьшей меткой окончания, поэтому клиент с весом 2
+ * обслуживается вдвое чаще клиента с весом 1, сколько бы запросов тот ни прислал.
+ */
+static Connection *pending_take(PendingQueue *queue)
+{
+    unsigned int pick = 0;
+
+    if (queue->fair)
+    {
+        for (unsigned int i = 1; i < queue->count; i++)
+        {
+            if (queue->items[(queue->head + i) % queue->capacity]->finish <
+                queue->items[(queue->head + pick) % queue->capacity]->finish)
+                pick = i;
+        }
+    }
+
+    Connection *conn = queue->items[(queue->head + pick) % queue->capacity];
+
+    // Запросы перед выбранным сдвигаем на его место, сохраняя порядок поступления
+    for (unsigned int i = pick; i > 0; i--)
+        queue->items[(queue->head + i) % queue->capacity] = queue->items[(queue->head + i - 1) % queue->capacity];
+    queue->head = (queue->head + 1) % queue->capacity;
+    queue->count--;
+
+    if (queue->fair)
+        queue->virtual_time = conn->finish;
+    return conn;
+}
+
+/**
+ * @brief Ставит запрос в очередь (вызывается под мьютексом).
+ *
+ * @return 0 при успехе, -1, если очередь заполнена.
+ */
+static int pending_put(PendingQueue *queue, Connection *conn)
+{
+    if (queue->count == queue->capacity)
+        return -1;
+
+    if (queue->fair)
+    {
+        uint64_t last = queue->last_finish[conn->peer.slot];
+        conn->finish = (last > queue->virtual_time ? last : queue->virtual_time) + FAIR_QUEUE_COST / conn->peer.weight;
+        queue->last_finish[conn->peer.slot] = conn->finish;
+    }
+    queue->items[(queue->head + queue->count) % queue->capacity] = conn;
+    queue->count++;
+    pthread_cond_signal(&queue->not_empty);
+    return 0;
+}
+
+/**
+ * @brief Поток-обработчик: формирует ответы на запросы из очереди по одному.
+ */
+static void *pending_handler(void *arg)
+{
+    PendingQueue *queue = arg;
+    uint64_t one = 1;
+
+    for (;;)
+    {
+        pthread_mutex_lock(&queue->lock);
+        while (queue->count == 0 && !queue->closing)
+            pthread_cond_wait(&queue->not_empty, &queue->lock);
+
+        // После остановки цикла ответы уже некому отправить: соединения закроет цикл,
+        // и запросы, оставшиеся в очереди после таймаута дренажа, не ходят в DNS
+        if (queue->closing)
+        {
+            pthread_mutex_unlock(&queue->lock);
+            break;
+        }
+        Connection *conn = pending_take(queue);
+        pthread_mutex_unlock(&queue->lock);
+
+        // Дедлайн отсчитывается от accept, поэтому включает и чтение запроса, и ожидание в очереди
+        admission_begin(conn->accepted_at);
+        PROBE1(request__start, conn->fd);
+        conn->response = queue->fn(conn->request, &conn->response_len, queue->arg);
+        PROBE2(request__built, conn->fd, conn->response_len);
+        admission_end();
+
+        // Будим поток ввода-вывода, только если он еще не знает о готовых ответах
+        pthread_mutex_lock(&queue->lock);
+        int was_empty = queue->done == NULL;
+        conn->next_done = queue->done;
+        queue->done = conn;
+        pthread_mutex_unlock(&queue->lock);
+
+        if (was_empty)
+        {
+            if (write(queue->wake_fd, &one, sizeof(one)) < 0)
+                perror("write");
+            __atomic_fetch_add(&queue->wakeups, 1, __ATOMIC_RELAXED);
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief Закрывает соединение и освобождает его (epoll забывает дескриптор при close).
+ */
+static void close_connection(SocketLoop *loop, Connection *conn)
+{
+    PROBE1(request__done, conn->fd);
+    timer_wheel_remove(&loop->timers, &conn->timer);
+    close(conn->fd);
+    loop->syscalls++;
+
+    if (conn->prev_open != NULL)
+        conn->prev_open->next_open = conn->next_open;
+    else
+        loop->open_list = conn->next_open;
+    if (conn->next_open != NULL)
+        conn->next_open->prev_open = conn->prev_open;
+    loop->open--;
+
+    free(conn->response);
+    free(conn);
+}
+
+/**
+ * @brief Меняет набор событий epoll для соединения.
+ *
+ * При `events == 0` сокет снимается с epoll: EPOLLHUP и EPOLLERR приходят при
+ * любой маске, и закрытое клиентом соединение в очереди будило бы цикл впустую.
+ */
+static int watch(SocketLoop *loop, Connection *conn, uint32_t events)
+{
+    struct epoll_event event = {.events = events, .data.ptr = conn};
+    int op = events == 0 ? EPOLL_CTL_DEL : conn->watched ? EPOLL_CTL_MOD : EPOLL_CTL_ADD;
+
+    loop->syscalls++;
+    if (epoll_ctl(loop->epoll_fd, op, conn->fd, &event) < 0)
+        return -1;
+    conn->watched = events != 0;
+    return 0;
+}
+
+/**
+ * @brief Ставит таймаут текущей стадии (0 - без таймаута).
+ */
+static void arm_timeout(SocketLoop *loop, Connection *conn, unsigned int timeout_ms, uint64_t now)
+{
+    if (timeout_ms > 0)
+        timer_wheel_add(&loop->timers, &conn->timer, now + timeout_ms);
+    else
+        timer_wheel_remove(&loop->timers, &conn->timer);
+}
+
+/**
+ * @brief Длина тела по заголовку Content-Length (0, если его нет).
+ */
+static size_t content_length(const char *headers, size_t headers_len)
+{
+    const char *header = strcasestr(headers, "\nContent-Length:");
+
+    if (header == NULL || header >= headers + headers_len)
+        return 0;
+    return strtoul(header + strlen("\nContent-Length:"), NULL, 10);
+}
+
+/**
+ * @brief Дочитывает доступные данные запроса.
+ *
+ * @return 1 - запрос прочитан, 0 - ждем еще данных, -1 - закрыть соединение.
+ */
+static int read_request(SocketLoop *loop, Connection *conn)
+{
+    size_t capacity = sizeof(conn->request) - 1;
+    ssize_t len = recv(conn->fd, conn->request + conn->request_len, capacity - conn->request_len, 0);
+
+    loop->syscalls++;
+    if (len < 0)
+        return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR ? 0 : -1;
+    if (len == 0)
+        return -1; // Клиент закрыл соединение, не дописав запрос
+
+    conn->request_len += len;
+    conn->request[conn->request_len] = '\0';
+
+    // Больше буфера не читаем: обрабатываем то, что поместилось
+    if (conn->request_len == capacity)
+        return 1;
+
+    if (conn->state == CONN_READ_HEADER)
+    {
+        // Путь без HTTP-заголовков (так шлет tools/bench-client) обрабатывается сразу
+        if (conn->request[0] == '/')
+            return 1;
+
+        const char *end = strstr(conn->request, "\r\n\r\n");
+        size_t separator = 4;
+        if (end == NULL)
+        {
+            end = strstr(conn->request, "\n\n");
+            separator = 2;
+        }
+        if (end == NULL)
+            return 0;
+
+        size_t headers_len = end - conn->request + separator;
+        conn->request_total = headers_len + content_length(conn->request, headers_len);
+        if (conn->request_total > capacity)
+            conn->request_total = capacity;
+        conn->state = CONN_READ_BODY;
+    }
+
+    return conn->request_len >= conn->request_total ? 1 : 0;
+}
+
+/**
+ * @brief Отправляет доступную часть ответа.
+ *
+ * @return 1 - ответ отправлен, 0 - сокет заполнен, -1 - ошибка.
+ */
+static int write_response(SocketLoop *loop, Connection *conn)
+{
+    while (conn->sent < conn->response_len)
+    {
+        ssize_t len = send(conn->fd, conn->response + conn->sent, conn->response_len - conn->sent, MSG_NOSIGNAL);
+        loop->syscalls++;
+        if (len < 0)
+            return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR ? 0 : -1;
+        conn->sent += len;
+    }
+    return 1;
+}
+
+/**
+ * @brief Начинает отправку готового ответа; что не ушло сразу, дописывается по EPOLLOUT.
+ */
+static void start_write(SocketLoop *loop, Connection *conn, uint64_t now)
+{
+    if (conn->response == NULL)
+    {
+        close_connection(loop, conn);
+        return;
+    }
+
+    conn->state = CONN_WRITE;
+    int status = write_response(loop, conn);
+    if (status == 0 && watch(loop, conn, EPOLLOUT) == 0)
+    {
+        arm_timeout(loop, conn, loop->limits->write_timeout_ms, now);
+        return;
+    }
+
+    if (status == 1)
+        loop->requests++;
+    close_connection(loop, conn);
+}
+
+/**
+ * @brief Запрос прочитан: в очередь обработчику или сразу отказ (429, 503).
+ */
+static void request_complete(SocketLoop *loop, Connection *conn, uint64_t now)
+{
+    PendingQueue *queue = &loop->queue;
+    int queued = 0;
+
+    timer_wheel_remove(&loop->timers, &conn->timer);
+    conn->state = CONN_QUEUED;
+
+    if (conn->rate_limited)
+    {
+        conn->response = admission_shed_response(SHED_RATE_LIMIT, &conn->response_len);
+        start_write(loop, conn, now);
+        return;
+    }
+
+    // Пока запрос у обработчика, события сокета не нужны
+    if (watch(loop, conn, 0) < 0)
+    {
+        close_connection(loop, conn);
+        return;
+    }
+
+    pthread_mutex_lock(&queue->lock);
+    queued = pending_put(queue, conn) == 0;
+    pthread_mutex_unlock(&queue->lock);
+
+    if (!queued)
+    {
+        conn->response = admission_shed_response(SHED_QUEUE_FULL, &conn->response_len);
+        start_write(loop, conn, now);
+    }
+}
+
+/**
+ * @brief Принимает ожидающие соединения, пока не достигнут предел.
+ */
+static void accept_connections(SocketLoop *loop, uint64_t now)
+{
+    while (loop->open < loop->limits->max_connections)
+    {
+        int fd = accept4(loop->server_sock, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        loop->syscalls++;
+        if (fd < 0)
+        {
+            // EAGAIN - очередь пуста (или соединение забрал другой рабочий процесс)
+            if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR && errno != ECONNABORTED)
+                perror("accept");
+            break;
+        }
+
+        Connection *conn = calloc(1, sizeof(Connection));
+        if (conn == NULL)
+        {
+            close(fd);
+            continue;
+        }
+        conn->fd = fd;
+        conn->state = CONN_READ_HEADER;
+        conn->accepted_at = now;
+
+        // Без --peer-limit клиентов не различаем: ни SO_PEERCRED, ни ведер токенов
+        if (loop->queue.fair)
+            conn->rate_limited = !peer_limit_admit(fd, &conn->peer);
+
+        if (watch(loop, conn, EPOLLIN) < 0)
+        {
+            perror("epoll_ctl");
+            close(fd);
+            free(conn);
+            continue;
+        }
+
+        conn->next_open = loop->open_list;
+        if (loop->open_list != NULL)
+            loop->open_list->prev_open = conn;
+        loop->open_list = conn;
+        loop->open++;
+        arm_timeout(loop, conn, loop->limits->header_timeout_ms, now);
+    }
+
+    // Достигнут предел: новые соединения ждут в очереди слушающего сокета
+    if (loop->open >= loop->limits->max_connections && loop->accepting)
+    {
+        epoll_ctl(loop->epoll_fd, EPOLL_CTL_DEL, loop->server_sock, NULL);
+        loop->syscalls++;
+        loop->accepting = 0;
+    }
+}
+
+/**
+ * @brief Возобновляет прием соединений.
+ */
+static void resume_accepting(SocketLoop *loop)
+{
+    struct epoll_event event = {.events = EPOLLIN | EPOLLEXCLUSIVE, .data.ptr = NULL};
+
+    loop->syscalls++;
+    if (epoll_ctl(loop->epoll_fd, EPOLL_CTL_ADD, loop->server_sock, &event) == 0)
+        loop->accepting = 1;
+}
+
+/**
+ * @brief Забирает готовые ответы у обработчика и начинает их отправку.
+ */
+static void collect_responses(SocketLoop *loop, uint64_t now)
+{
+    uint64_t value;
+
+    if (read(loop->queue.wake_fd, &value, sizeof(value)) < 0 && errno != EAGAIN)
+        perror("read");
+    loop->syscalls++;
+
+    pthread_mutex_lock(&loop->queue.lock);
+    Connection *conn = loop->queue.done;
+    loop->queue.done = NULL;
+    pthread_mutex_unlock(&loop->queue.lock);
+
+    while (conn != NULL)
+    {
+        Connection *next = conn->next_done;
+        start_write(loop, conn, now);
+        conn = next;
+    }
+}
+
+/**
+ * @brief Закрывает соединение, не уложившееся в таймаут своей стадии.
+ */
+static void expire_connection(TimerEntry *entry, void *arg)
+{
+    SocketLoop *loop = arg;
+    Connection *conn = (Connection *)entry;
+
+    if (conn->state == CONN_READ_HEADER)
+        loop->timeouts[0]++;
+    else if (conn->state == CONN_READ_BODY)
+        loop->timeouts[1]++;
+    else
+        loop->timeouts[2]++;
+    close_connection(loop, conn);
+}
+
+/**
+ * @brief Обрабатывает событие соединения.
+ */
+static void handle_event(SocketLoop *loop, Connection *conn, uint32_t events, uint64_t now)
+{
+    if (conn->state == CONN_READ_HEADER || conn->state == CONN_READ_BODY)
+    {
+        ConnectionState before = conn->state;
+        int status = read_request(loop, conn);
+
+        if (status < 0)
+            close_connection(loop, conn);
+        else if (status > 0)
+            request_complete(loop, conn, now);
+        else if (conn->state != before)
+            arm_timeout(loop, conn, loop->limits->body_timeout_ms, now);
+    }
+    else if (conn->state == CONN_WRITE && (events & (EPOLLOUT | EPOLLERR | EPOLLHUP)))
+    {
+        int status = write_response(loop, conn);
+
+        if (status == 1)
+            loop->requests++;
+        if (status != 0)
+            close_connection(loop, conn);
+    }
+}
+
+int socket_serve(int server_sock, const ConnectionLimits *limits, SocketResponseFn fn, void *arg,
+                 volatile sig_atomic_t *stop, SocketStopFn on_stop)
+{
+    SocketLoop loop;
+    PendingQueue *queue = &loop.queue;
+    struct epoll_event events[EVENT_BATCH];
+    sigset_t blocked, wait_mask;
+    pthread_t handler;
+    uint64_t drain_deadline = 0;
+
+    memset(&loop, 0, sizeof(loop));
+    loop.server_sock = server_sock;
+    loop.limits = limits;
+    queue->capacity = admission_queue_depth();
+    queue->fair = peer_limit_enabled();
+    queue->fn = fn;
+    queue->arg = arg;
+
+    // Слушающий сокет мог прийти от предыдущего процесса, режим выставляем явно
+    fcntl(server_sock, F_SETFL, fcntl(server_sock, F_GETFL) | O_NONBLOCK);
+
+    loop.epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    queue->wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    queue->items = calloc(queue->capacity, sizeof(Connection *));
+    if (loop.epoll_fd < 0 || queue->wake_fd < 0 || queue->items == NULL ||
+        timer_wheel_init(&loop.timers, SOCKET_TIMER_SLOTS, SOCKET_TIMER_TICK_MS, admission_now_ms()) < 0)
+    {
+        perror("socket_serve");
+        if (loop.epoll_fd >= 0)
+            close(loop.epoll_fd);
+        if (queue->wake_fd >= 0)
+            close(queue->wake_fd);
+        free(queue->items);
+        return -1;
+    }
+
+    struct epoll_event wake_event = {.events = EPOLLIN, .data.ptr = queue};
+    epoll_ctl(loop.epoll_fd, EPOLL_CTL_ADD, queue->wake_fd, &wake_event);
+    resume_accepting(&loop);
+
+    pthread_mutex_init(&queue->lock, NULL);
+    pthread_cond_init(&queue->not_empty, NULL);
+
+    // Сигналы остановки доставляются только внутри epoll_pwait, чтобы не потерять их между проверкой и ожиданием
+    sigemptyset(&blocked);
+    sigaddset(&blocked, SIGINT);
+    sigaddset(&blocked, SIGTERM);
+    sigaddset(&blocked, SIGUSR2);
+    pthread_sigmask(SIG_BLOCK, &blocked, &wait_mask);
+    int status = pthread_create(&handler, NULL, pending_handler, queue);
+    if (status != 0)
+    {
+        fprintf(stderr, "pthread_create: %s\n", strerror(status));
+        pthread_sigmask(SIG_SETMASK, &wait_mask, NULL);
+        close(loop.epoll_fd);
+        close(queue->wake_fd);
+        free(queue->items);
+        timer_wheel_destroy(&loop.timers);
+        return -1;
+    }
+    sigdelset(&wait_mask, SIGINT);
+    sigdelset(&wait_mask, SIGTERM);
+    sigdelset(&wait_mask, SIGUSR2);
+
+    for (;;)
+    {
+        uint64_t now = admission_now_ms();
+
+        // Перед дренажом даем вызывающему передать слушающий сокет (он может и отменить остановку)
+        if (*stop && drain_deadline == 0 && on_stop != NULL)
+            on_stop(arg);
+
+        // При остановке перестаем принимать соединения и дообслуживаем открытые
+        if (*stop)
+        {
+            if (drain_deadline == 0)
+                drain_deadline = now + DRAIN_TIMEOUT_MS;
+            if (loop.accepting)
+            {
+                epoll_ctl(loop.epoll_fd, EPOLL_CTL_DEL, server_sock, NULL);
+                loop.accepting = 0;
+            }
+            if (loop.open == 0 || now >= drain_deadline)
+                break;
+        }
+        else if (!loop.accepting && loop.open < limits->max_connections)
+        {
+            resume_accepting(&loop);
+        }
+
+        int timeout = timer_wheel_timeout_ms(&loop.timers, now);
+        if (drain_deadline != 0 && (timeout < 0 || timeout > SOCKET_TIMER_TICK_MS))
+            timeout = SOCKET_TIMER_TICK_MS;
+
+        int count = epoll_pwait(loop.epoll_fd, events, EVENT_BATCH, timeout, &wait_mask);
+        loop.syscalls++;
+        if (count < 0 && errno != EINTR)
+        {
+            perror("epoll_pwait");
+            break;
+        }
+
+        now = admission_now_ms();
+        for (int i = 0; i < count; i++)
+        {
+            if (events[i].data.ptr == NULL)
+                accept_connections(&loop, now);
+            else if (events[i].data.ptr == queue)
+                collect_responses(&loop, now);
+            else
+                handle_event(&loop, events[i].data.ptr, events[i].events, now);
+        }
+
+        timer_wheel_advance(&loop.timers, now, expire_connection, &loop);
+    }
+
+    // Обработчик дописывает текущий ответ и выходит, не трогая очередь; затем закрываем все, что осталось открытым
+    pthread_mutex_lock(&queue->lock);
+    queue->closing = 1;
+    pthread_cond_signal(&queue->not_empty);
+    pthread_mutex_unlock(&queue->lock);
+    pthread_join(handler, NULL);
+    pthread_sigmask(SIG_UNBLOCK, &blocked, NULL);
+
+    while (loop.open_list != NULL)
+        close_connection(&loop, loop.open_list);
+
+    unsigned long syscalls = loop.syscalls + queue->wakeups;
+    printf("sockets: обработано запросов: %lu, системных вызовов: %lu (%.2f на запрос), "
+           "закрыто по таймауту: заголовки %lu, тело %lu, запись %lu\n",
+           loop.requests, syscalls, loop.requests > 0 ? (double)syscalls / loop.requests : 0.0,
+           loop.timeouts[0], loop.timeouts[1], loop.timeouts[2]);
+
+    pthread_cond_destroy(&queue->not_empty);
+    pthread_mutex_destroy(&queue->lock);
+    timer_wheel_destroy(&loop.timers);
+    close(queue->wake_fd);
+    close(loop.epoll_fd);
+    free(queue->items);
+    return 0;
+}
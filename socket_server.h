@@ -0,0 +1,75 @@
+#ifndef SOCKET_SERVER_H
+#define SOCKET_SERVER_H
+
+#include <stddef.h>
+#include <signal.h>
+
+#define SOCKET_DEFAULT_HEADER_TIMEOUT_MS 5000  /**< Сколько ждать заголовков запроса по умолчанию, мс. */
+#define SOCKET_DEFAULT_BODY_TIMEOUT_MS 10000   /**< Сколько ждать тела запроса по умолчанию, мс. */
+#define SOCKET_DEFAULT_WRITE_TIMEOUT_MS 10000  /**< Сколько ждать, пока клиент прочтет ответ, по умолчанию, мс. */
+#define SOCKET_DEFAULT_MAX_CONNECTIONS 1024    /**< Предел открытых соединений на процесс по умолчанию. */
+#define SOCKET_REQUEST_SIZE 1024               /**< Буфер запроса (больший запрос обрезается, как и раньше). */
+#define SOCKET_TIMER_TICK_MS 100               /**< Точность таймаутов. */
+#define SOCKET_TIMER_SLOTS 1024                /**< Слотов в колесе таймеров (горизонт - 102.4 с). */
+
+/**
+ * @brief Таймауты и предел соединений.
+ */
+typedef struct
+{
+    unsigned int header_timeout_ms; /**< От accept до конца заголовков (0 - без таймаута). */
+    unsigned int body_timeout_ms;   /**< От конца заголовков до конца тела по Content-Length (0 - без таймаута). */
+    unsigned int write_timeout_ms;  /**< На отправку ответа (0 - без таймаута). */
+    unsigned int max_connections;   /**< Открытых соединений на процесс; при достижении accept приостанавливается. */
+} ConnectionLimits;
+
+/**
+ * @brief Формирует ответ на запрос (не выполняет ввода-вывода с клиентом).
+ *
+ * @param request Текст запроса, завершенный нулем.
+ * @param response_len Длина ответа.
+ * @param arg Аргумент, переданный в `socket_serve`.
+ * @return Ответ, выделенный через malloc, или NULL (соединение закрывается).
+ */
+typedef char *(*SocketResponseFn)(const char *request, size_t *response_len, void *arg);
+
+/**
+ * @brief Вызывается, когда цикл заметил `*stop`, но еще принимает соединения.
+ *
+ * Функция может сбросить флаг остановки - тогда цикл продолжает работу. Так
+ * процесс передает слушающий сокет новой версии, пока сам не перестал
+ * принимать соединения, и только после этого дообслуживает открытые.
+ *
+ * @param arg Аргумент, переданный в цикл обслуживания.
+ */
+typedef void (*SocketStopFn)(void *arg);
+
+/**
+ * @brief Обслуживает соединения на неблокирующих сокетах, пока не выставлен `*stop`.
+ *
+ * Поток ввода-вывода ведет все соединения через epoll: принимает их, читает
+ * запросы и отправляет ответы, а медленных клиентов закрывает по таймаутам из
+ * колеса таймеров. Прочитанные запросы попадают в ограниченную очередь
+ * (`admission_queue_depth`), из которой отдельный поток формирует ответы по
+ * одному; при заполненной очереди клиент получает 503. С `--peer-limit` клиент
+ * определяется при accept: превысивший скорость получает 429, а очередь
+ * обслуживается справедливо по весам uid.
+ *
+ * Запрос считается прочитанным, когда пришли заголовки HTTP (и тело по
+ * `Content-Length`) или, если он начинается с `/`, сразу после первых данных.
+ *
+ * При остановке сначала вызывает `on_stop` (если задана), затем перестает
+ * принимать соединения и дообслуживает открытые.
+ *
+ * @param server_sock Слушающий сокет (переводится в неблокирующий режим).
+ * @param limits Таймауты и предел соединений.
+ * @param fn Функция формирования ответа.
+ * @param arg Аргумент для `fn` и `on_stop`.
+ * @param stop Флаг остановки, выставляемый обработчиком сигнала.
+ * @param on_stop Функция, вызываемая перед дренажом, или NULL.
+ * @return 0 после остановки, -1 при ошибке запуска.
+ */
+int socket_serve(int server_sock, const ConnectionLimits *limits, SocketResponseFn fn, void *arg,
+                 volatile sig_atomic_t *stop, SocketStopFn on_stop);
+
+#endif // SOCKET_SERVER_H
@@ -0,0 +1,98 @@
+#include <stdlib.h>
+
+#include "timer_wheel.h"
+
+int timer_wheel_init(TimerWheel *wheel, unsigned int slot_count, unsigned int tick_ms, uint64_t now)
+{
+    wheel->slots = calloc(slot_count, sizeof(TimerEntry));
+    if (wheel->slots == NULL)
+        return -1;
+
+    // Пустой слот - фиктивный элемент, замкнутый сам на себя
+    for (unsigned int i = 0; i < slot_count; i++)
+    {
+        wheel->slots[i].prev = &wheel->slots[i];
+        wheel->slots[i].next = &wheel->slots[i];
+    }
+    wheel->slot_count = slot_count;
+    wheel->tick_ms = tick_ms;
+    wheel->current_tick = now / tick_ms;
+    wheel->armed = 0;
+    return 0;
+}
+
+void timer_wheel_destroy(TimerWheel *wheel)
+{
+    free(wheel->slots);
+    wheel->slots = NULL;
+}
+
+void timer_wheel_remove(TimerWheel *wheel, TimerEntry *entry)
+{
+    if (!entry->armed)
+        return;
+    wheel->armed--;
+    entry->prev->next = entry->next;
+    entry->next->prev = entry->prev;
+    entry->prev = entry->next = NULL;
+    entry->armed = 0;
+}
+
+void timer_wheel_add(TimerWheel *wheel, TimerEntry *entry, uint64_t expires_at)
+{
+    // Слот тика, к началу которого таймер уже истек (округление вверх)
+    uint64_t tick = (expires_at + wheel->tick_ms - 1) / wheel->tick_ms;
+
+    timer_wheel_remove(wheel, entry);
+
+    // Таймер в прошлом или в текущем тике срабатывает на следующем тике
+    if (tick <= wheel->current_tick)
+        tick = wheel->current_tick + 1;
+
+    TimerEntry *head = &wheel->slots[tick % wheel->slot_count];
+    entry->expires_at = expires_at;
+    entry->prev = head->prev;
+    entry->next = head;
+    head->prev->next = entry;
+    head->prev = entry;
+    entry->armed = 1;
+    wheel->armed++;
+}
+
+void timer_wheel_advance(TimerWheel *wheel, uint64_t now, TimerExpireFn fn, void *arg)
+{
+    uint64_t target = now / wheel->tick_ms;
+
+    // После долгой паузы достаточно одного оборота: каждый слот будет просмотрен
+    if (target - wheel->current_tick > wheel->slot_count)
+        wheel->current_tick = target - wheel->slot_count;
+
+    while (wheel->current_tick < target)
+    {
+        wheel->current_tick++;
+        TimerEntry *head = &wheel->slots[wheel->current_tick % wheel->slot_count];
+
+        for (TimerEntry *entry = head->next; entry != head;)
+        {
+            TimerEntry *next = entry->next;
+
+            // Таймеры дальше горизонта колеса ждут следующего оборота
+            if (entry->expires_at <= now)
+            {
+                timer_wheel_remove(wheel, entry);
+                fn(entry, arg);
+            }
+            entry = next;
+        }
+    }
+}
+
+int timer_wheel_timeout_ms(const TimerWheel *wheel, uint64_t now)
+{
+    uint64_t next_tick_at = (wheel->current_tick + 1) * wheel->tick_ms;
+
+    if (wheel->armed == 0)
+        return -1;
+
+    return next_tick_at > now ? (int)(next_tick_at - now) : 0;
+}
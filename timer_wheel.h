@@ -0,0 +1,76 @@
+#ifndef TIMER_WHEEL_H
+#define TIMER_WHEEL_H
+
+#include <stdint.h>
+
+/**
+ * @brief Таймер, встраиваемый в структуру владельца (например, соединения).
+ */
+typedef struct TimerEntry
+{
+    struct TimerEntry *prev; /**< Предыдущий таймер в слоте. */
+    struct TimerEntry *next; /**< Следующий таймер в слоте. */
+    uint64_t expires_at;     /**< Момент срабатывания, мс. */
+    int armed;               /**< Таймер стоит в колесе. */
+} TimerEntry;
+
+/**
+ * @brief Колесо таймеров: слоты по `tick_ms`, в каждом - двусвязный список.
+ *
+ * Постановка и снятие таймера - O(1), а на каждом тике просматривается один
+ * слот, поэтому тысячи соединений с таймаутами не стоят ни потока, ни
+ * отдельного системного вызова на каждое.
+ */
+typedef struct
+{
+    TimerEntry *slots;     /**< Головы списков (фиктивные элементы). */
+    unsigned int slot_count;
+    unsigned int tick_ms;
+    uint64_t current_tick; /**< Последний обработанный тик. */
+    unsigned long armed;   /**< Сколько таймеров стоит в колесе. */
+} TimerWheel;
+
+/**
+ * @brief Вызывается для сработавшего таймера (уже снятого с колеса).
+ */
+typedef void (*TimerExpireFn)(TimerEntry *entry, void *arg);
+
+/**
+ * @brief Создает колесо.
+ *
+ * @param wheel Колесо.
+ * @param slot_count Количество слотов (горизонт - slot_count * tick_ms, дальние таймеры ждут лишний оборот).
+ * @param tick_ms Длительность тика, мс.
+ * @param now Текущее время, мс.
+ * @return 0 при успехе, -1 при ошибке.
+ */
+int timer_wheel_init(TimerWheel *wheel, unsigned int slot_count, unsigned int tick_ms, uint64_t now);
+
+/**
+ * @brief Освобождает колесо (таймеры владельцев не трогает).
+ */
+void timer_wheel_destroy(TimerWheel *wheel);
+
+/**
+ * @brief Ставит (или переставляет) таймер на момент `expires_at`.
+ */
+void timer_wheel_add(TimerWheel *wheel, TimerEntry *entry, uint64_t expires_at);
+
+/**
+ * @brief Снимает таймер, если он стоит.
+ */
+void timer_wheel_remove(TimerWheel *wheel, TimerEntry *entry);
+
+/**
+ * @brief Обрабатывает тики до момента `now` и вызывает `fn` для истекших таймеров.
+ */
+void timer_wheel_advance(TimerWheel *wheel, uint64_t now, TimerExpireFn fn, void *arg);
+
+/**
+ * @brief Сколько миллисекунд ждать до следующего тика (таймаут для epoll_wait).
+ *
+ * @return Миллисекунды или -1, если таймеров нет и ждать можно бесконечно.
+ */
+int timer_wheel_timeout_ms(const TimerWheel *wheel, uint64_t now);
+
+#endif // TIMER_WHEEL_H
@@ -0,0 +1,211 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+/**
+ * @file bench-client.c
+ * @brief Генератор нагрузки для Unix-сервера.
+ *
+ * Отправляет запросы `/what-is-country/<домен>` по доменам из файла в несколько
+ * потоков и печатает пропускную способность и перцентили задержки.
+ * С флагом `-e` проверяет, что каждый ответ содержит ожидаемую строку
+ * (второй столбец файла доменов), что позволяет использовать его как регрессионный тест.
+ *
+ * Запуск: `bench-client -f domains.txt [-s /tmp/myserver.sock] [-n 1000] [-c 4] [-e]`
+ */
+
+#define MAX_DOMAINS 4096
+#define RESPONSE_SIZE 65536
+
+/**
+ * @brief Домен и ожидаемая подстрока ответа.
+ */
+typedef struct
+{
+    char domain[256];
+    char expect[128];
+} Target;
+
+/**
+ * @brief Состояние одного потока нагрузки.
+ */
+typedef struct
+{
+    int id;
+    long requests;     /**< Сколько запросов выполнить. */
+    double *latencies; /**< Задержки в миллисекундах. */
+    long done;         /**< Выполнено запросов. */
+    long errors;       /**< Ошибки соединения или несовпадения ответа. */
+} Worker;
+
+static Target targets[MAX_DOMAINS];
+static int target_count = 0;
+static const char *socket_path = "/tmp/myserver.sock";
+static int check_expect = 0;
+
+static double now_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+}
+
+/**
+ * @brief Выполняет один запрос и возвращает 0 при успехе.
+ */
+static int do_request(const Target *t)
+{
+    struct sockaddr_un addr;
+    char request[512];
+    char response[RESPONSE_SIZE];
+    size_t total = 0;
+    ssize_t n;
+    int sock = socket(AF_UNIX, SOCK_STREAM, 0);
+
+    if (sock < 0)
+        return -1;
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, socket_path, sizeof(addr.sun_path) - 1);
+    if (connect(sock, (struct sockaddr *)&addr, sizeof(addr)) < 0)
+    {
+        close(sock);
+        return -1;
+    }
+
+    int len = snprintf(request, sizeof(request), "/what-is-country/%s", t->domain);
+    if (send(sock, request, len, 0) != len)
+    {
+        close(sock);
+        return -1;
+    }
+
+    while (total < sizeof(response) - 1 && (n = recv(sock, response + total, sizeof(response) - 1 - total, 0)) > 0)
+        total += n;
+    response[total] = '\0';
+    close(sock);
+
+    if (total == 0)
+        return -1;
+    if (check_expect && t->expect[0] != '\0' && strstr(response, t->expect) == NULL)
+    {
+        fprintf(stderr, "bench-client: %s - нет '%s' в ответе\n", t->domain, t->expect);
+        return -1;
+    }
+    return 0;
+}
+
+static void *worker_main(void *arg)
+{
+    Worker *w = arg;
+
+    for (long i = 0; i < w->requests; i++)
+    {
+        const Target *t = &targets[(w->id + i) % target_count];
+        double start = now_ms();
+        if (do_request(t) < 0)
+            w->errors++;
+        w->latencies[w->done++] = now_ms() - start;
+    }
+    return NULL;
+}
+
+static int cmp_double(const void *a, const void *b)
+{
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+int main(int argc, char *argv[])
+{
+    const char *domains_file = NULL;
+    long total = 1000;
+    int concurrency = 4;
+    int opt;
+    char line[512];
+
+    while ((opt = getopt(argc, argv, "f:s:n:c:e")) != -1)
+    {
+        switch (opt)
+        {
+        case 'f': domains_file = optarg; break;
+        case 's': socket_path = optarg; break;
+        case 'n': total = atol(optarg); break;
+        case 'c': concurrency = atoi(optarg); break;
+        case 'e': check_expect = 1; break;
+        default:
+            fprintf(stderr, "Использование: %s -f domains.txt [-s socket] [-n requests] [-c threads] [-e]\n", argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    FILE *fp = domains_file != NULL ? fopen(domains_file, "r") : NULL;
+    if (fp == NULL)
+    {
+        fprintf(stderr, "bench-client: не удалось открыть файл доменов (-f)\n");
+        return EXIT_FAILURE;
+    }
+    while (fgets(line, sizeof(line), fp) != NULL && target_count < MAX_DOMAINS)
+    {
+        Target *t = &targets[target_count];
+        t->expect[0] = '\0';
+        if (line[0] == '#' || sscanf(line, "%255s %127[^\n]", t->domain, t->expect) < 1)
+            continue;
+        target_count++;
+    }
+    fclose(fp);
+
+    if (target_count == 0 || concurrency < 1 || total < 1)
+    {
+        fprintf(stderr, "bench-client: нет доменов или некорректные параметры\n");
+        return EXIT_FAILURE;
+    }
+
+    pthread_t *threads = calloc(concurrency, sizeof(pthread_t));
+    Worker *workers = calloc(concurrency, sizeof(Worker));
+    double *latencies = calloc(total, sizeof(double));
+    if (threads == NULL || workers == NULL || latencies == NULL)
+    {
+        perror("calloc");
+        return EXIT_FAILURE;
+    }
+
+    double start = now_ms();
+    long offset = 0;
+    for (int i = 0; i < concurrency; i++)
+    {
+        workers[i].id = i;
+        workers[i].requests = total / concurrency + (i < total % concurrency);
+        workers[i].latencies = latencies + offset;
+        offset += workers[i].requests;
+        pthread_create(&threads[i], NULL, worker_main, &workers[i]);
+    }
+
+    long errors = 0;
+    for (int i = 0; i < concurrency; i++)
+    {
+        pthread_join(threads[i], NULL);
+        errors += workers[i].errors;
+    }
+    double elapsed = now_ms() - start;
+
+    qsort(latencies, total, sizeof(double), cmp_double);
+    printf("запросов: %ld, ошибок: %ld, потоков: %d\n", total, errors, concurrency);
+    printf("время: %.1f мс, пропускная способность: %.1f запр/с\n", elapsed, total * 1000.0 / elapsed);
+    printf("задержка p50: %.2f мс, p95: %.2f мс, p99: %.2f мс, max: %.2f мс\n",
+           latencies[total / 2], latencies[total * 95 / 100], latencies[total * 99 / 100], latencies[total - 1]);
+
+    free(threads);
+    free(workers);
+    free(latencies);
+    return errors == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+// gcc -o bench-client tools/bench-client.c -lpthread
@@ -0,0 +1,371 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+#include <time.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdint.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+/**
+ * @file dns-stub.c
+ * @brief Заглушка DNS-сервера для детерминированных тестов и бенчмарков.
+ *
+ * Слушает UDP на 127.0.0.1 и отвечает A-записями из файла сценария.
+ * Формат строки сценария:
+ *
+ *     example.com 300 93.184.216.34 93.184.216.35 [delay=50] [loss=10]
+ *
+ * где 300 - TTL в секундах, `delay` - задержка ответа в миллисекундах,
+ * `loss` - вероятность потери ответа в процентах. Строки, начинающиеся с `#`,
+ * игнорируются. Для неизвестных доменов возвращается NXDOMAIN.
+ *
+ * Запуск: `dns-stub -f answers.txt [-p 5353] [-d delay_ms] [-l loss_pct] [-s seed]`
+ */
+
+#define MAX_ANSWERS 4096
+#define MAX_IPS 16
+#define MAX_PENDING 1024
+#define PACKET_SIZE 512
+
+/**
+ * @brief Заскриптованный ответ для одного домена.
+ */
+typedef struct
+{
+    char domain[256];        /**< Имя домена без завершающей точки. */
+    uint32_t ttl;            /**< TTL в секундах. */
+    struct in_addr ips[MAX_IPS]; /**< Список IPv4-адресов. */
+    int ip_count;            /**< Количество адресов. */
+    int delay_ms;            /**< Задержка ответа (-1 - использовать глобальную). */
+    int loss_pct;            /**< Вероятность потери (-1 - использовать глобальную). */
+} Answer;
+
+/**
+ * @brief Ответ, ожидающий отправки после искусственной задержки.
+ */
+typedef struct
+{
+    struct timespec due;          /**< Момент отправки. */
+    struct sockaddr_in peer;      /**< Адрес клиента. */
+    unsigned char data[PACKET_SIZE]; /**< Готовый пакет. */
+    size_t len;                   /**< Длина пакета. */
+} Pending;
+
+static Answer answers[MAX_ANSWERS];
+static int answer_count = 0;
+static Pending pending[MAX_PENDING];
+static int pending_count = 0;
+static volatile sig_atomic_t running = 1;
+
+static void on_signal(int sig)
+{
+    (void)sig;
+    running = 0;
+}
+
+/**
+ * @brief Загружает файл сценария.
+ *
+ * @param path Путь к файлу.
+ * @return 0 при успехе, -1 при ошибке.
+ */
+static int load_script(const char *path)
+{
+    FILE *fp = fopen(path, "r");
+    char line[4096];
+
+    if (fp == NULL)
+    {
+        perror("fopen");
+        return -1;
+    }
+
+    while (fgets(line, sizeof(line), fp) != NULL && answer_count < MAX_ANSWERS)
+    {
+        Answer *a = &answers[answer_count];
+        char *save = NULL;
+        char *tok = strtok_r(line, " \t\r\n", &save);
+
+        if (tok == NULL || tok[0] == '#')
+            continue;
+
+        memset(a, 0, sizeof(*a));
+        a->delay_ms = -1;
+        a->loss_pct = -1;
+        snprintf(a->domain, sizeof(a->domain), "%s", tok);
+        if (a->domain[0] != '\0' && a->domain[strlen(a->domain) - 1] == '.')
+            a->domain[strlen(a->domain) - 1] = '\0';
+
+        tok = strtok_r(NULL, " \t\r\n", &save);
+        a->ttl = tok != NULL ? (uint32_t)strtoul(tok, NULL, 10) : 300;
+
+        while ((tok = strtok_r(NULL, " \t\r\n", &save)) != NULL)
+        {
+            if (strncmp(tok, "delay=", 6) == 0)
+                a->delay_ms = atoi(tok + 6);
+            else if (strncmp(tok, "loss=", 5) == 0)
+                a->loss_pct = atoi(tok + 5);
+            else if (a->ip_count < MAX_IPS && inet_pton(AF_INET, tok, &a->ips[a->ip_count]) == 1)
+                a->ip_count++;
+            else
+                fprintf(stderr, "dns-stub: пропущен токен '%s' для %s\n", tok, a->domain);
+        }
+        answer_count++;
+    }
+
+    fclose(fp);
+    return 0;
+}
+
+/**
+ * @brief Ищет ответ для домена (без учета регистра).
+ */
+static const Answer *find_answer(const char *domain)
+{
+    for (int i = 0; i < answer_count; i++)
+    {
+        if (strcasecmp(answers[i].domain, domain) == 0)
+            return &answers[i];
+    }
+    return NULL;
+}
+
+/**
+ * @brief Разбирает секцию вопроса DNS-пакета.
+ *
+ * @param pkt Пакет.
+ * @param len Длина пакета.
+ * @param name Буфер для имени домена.
+ * @param name_size Размер буфера.
+ * @param qtype Тип запроса.
+ * @return Смещение конца секции вопроса или 0 при ошибке.
+ */
+static size_t parse_question(const unsigned char *pkt, size_t len, char *name, size_t name_size, uint16_t *qtype)
+{
+    size_t pos = 12;
+    size_t out = 0;
+
+    while (pos < len && pkt[pos] != 0)
+    {
+        size_t label = pkt[pos++];
+        if (label > 63 || pos + label > len || out + label + 2 > name_size)
+            return 0;
+        if (out > 0)
+            name[out++] = '.';
+        memcpy(name + out, pkt + pos, label);
+        out += label;
+        pos += label;
+    }
+    name[out] = '\0';
+
+    // Нулевая метка + QTYPE + QCLASS
+    if (pos + 5 > len)
+        return 0;
+    *qtype = (uint16_t)((pkt[pos + 1] << 8) | pkt[pos + 2]);
+    return pos + 5;
+}
+
+/**
+ * @brief Формирует ответ на запрос.
+ *
+ * @return Длина ответа или 0, если запрос некорректен.
+ */
+static size_t build_reply(const unsigned char *query, size_t qlen, unsigned char *reply, const Answer **matched)
+{
+    char name[256];
+    uint16_t qtype = 0;
+    size_t qend = parse_question(query, qlen, name, sizeof(name), &qtype);
+    const Answer *a;
+    size_t pos;
+    int ancount = 0;
+
+    if (qend == 0)
+        return 0;
+
+    a = find_answer(name);
+    *matched = a;
+
+    memcpy(reply, query, qend);
+    reply[2] = 0x81 | (query[2] & 0x01); // QR + RD из запроса
+    reply[3] = 0x80 | (a == NULL ? 3 : 0); // RA + RCODE (3 - NXDOMAIN)
+    reply[4] = 0;
+    reply[5] = 1;
+    reply[8] = reply[9] = reply[10] = reply[11] = 0; // без NS и ADDITIONAL
+    pos = qend;
+
+    // Отвечаем только на A-запросы класса IN, для остальных - пустой ответ
+    if (a != NULL && qtype == 1)
+    {
+        for (int i = 0; i < a->ip_count && pos + 16 <= PACKET_SIZE; i++)
+        {
+            reply[pos++] = 0xC0; // Указатель на имя из вопроса
+            reply[pos++] = 0x0C;
+            reply[pos++] = 0;
+            reply[pos++] = 1; // TYPE A
+            reply[pos++] = 0;
+            reply[pos++] = 1; // CLASS IN
+            reply[pos++] = (a->ttl >> 24) & 0xFF;
+            reply[pos++] = (a->ttl >> 16) & 0xFF;
+            reply[pos++] = (a->ttl >> 8) & 0xFF;
+            reply[pos++] = a->ttl & 0xFF;
+            reply[pos++] = 0;
+            reply[pos++] = 4;
+            memcpy(reply + pos, &a->ips[i], 4);
+            pos += 4;
+            ancount++;
+        }
+    }
+    reply[6] = (ancount >> 8) & 0xFF;
+    reply[7] = ancount & 0xFF;
+
+    return pos;
+}
+
+static long ms_until(const struct timespec *due)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    long ms = (due->tv_sec - now.tv_sec) * 1000 + (due->tv_nsec - now.tv_nsec) / 1000000;
+    return ms < 0 ? 0 : ms;
+}
+
+/**
+ * @brief Отправляет ответы, у которых истекла задержка, и возвращает таймаут до следующего.
+ */
+static int flush_pending(int sock)
+{
+    int timeout = -1;
+
+    for (int i = 0; i < pending_count;)
+    {
+        long ms = ms_until(&pending[i].due);
+        if (ms == 0)
+        {
+            sendto(sock, pending[i].data, pending[i].len, 0, (struct sockaddr *)&pending[i].peer, sizeof(pending[i].peer));
+            pending[i] = pending[--pending_count];
+            continue;
+        }
+        if (timeout < 0 || ms < timeout)
+            timeout = (int)ms;
+        i++;
+    }
+    return timeout;
+}
+
+int main(int argc, char *argv[])
+{
+    const char *script = NULL;
+    int port = 5353;
+    int delay_ms = 0;
+    int loss_pct = 0;
+    unsigned int seed = 1;
+    int opt;
+    int sock;
+    struct sockaddr_in addr;
+    unsigned long queries = 0, dropped = 0;
+
+    while ((opt = getopt(argc, argv, "f:p:d:l:s:")) != -1)
+    {
+        switch (opt)
+        {
+        case 'f': script = optarg; break;
+        case 'p': port = atoi(optarg); break;
+        case 'd': delay_ms = atoi(optarg); break;
+        case 'l': loss_pct = atoi(optarg); break;
+        case 's': seed = (unsigned int)strtoul(optarg, NULL, 10); break;
+        default:
+            fprintf(stderr, "Использование: %s -f answers.txt [-p port] [-d delay_ms] [-l loss_pct] [-s seed]\n", argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (script == NULL || load_script(script) < 0)
+    {
+        fprintf(stderr, "dns-stub: не задан или не прочитан файл сценария (-f)\n");
+        return EXIT_FAILURE;
+    }
+    srand(seed);
+
+    sock = socket(AF_INET, SOCK_DGRAM, 0);
+    if (sock < 0)
+    {
+        perror("socket");
+        return EXIT_FAILURE;
+    }
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons((uint16_t)port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (bind(sock, (struct sockaddr *)&addr, sizeof(addr)) < 0)
+    {
+        perror("bind");
+        close(sock);
+        return EXIT_FAILURE;
+    }
+
+    signal(SIGINT, on_signal);
+    signal(SIGTERM, on_signal);
+    printf("dns-stub: %d доменов, слушаю 127.0.0.1:%d\n", answer_count, port);
+    fflush(stdout);
+
+    while (running)
+    {
+        struct pollfd pfd = {.fd = sock, .events = POLLIN};
+        int timeout = flush_pending(sock);
+
+        if (poll(&pfd, 1, timeout) <= 0 || !(pfd.revents & POLLIN))
+            continue;
+
+        unsigned char query[PACKET_SIZE];
+        struct sockaddr_in peer;
+        socklen_t peer_len = sizeof(peer);
+        ssize_t n = recvfrom(sock, query, sizeof(query), 0, (struct sockaddr *)&peer, &peer_len);
+        if (n < 12)
+            continue;
+        queries++;
+
+        Pending p;
+        const Answer *a = NULL;
+        p.len = build_reply(query, (size_t)n, p.data, &a);
+        if (p.len == 0)
+            continue;
+
+        int loss = (a != NULL && a->loss_pct >= 0) ? a->loss_pct : loss_pct;
+        int delay = (a != NULL && a->delay_ms >= 0) ? a->delay_ms : delay_ms;
+        if (loss > 0 && rand() % 100 < loss)
+        {
+            dropped++;
+            continue;
+        }
+
+        if (delay <= 0 || pending_count == MAX_PENDING)
+        {
+            sendto(sock, p.data, p.len, 0, (struct sockaddr *)&peer, peer_len);
+            continue;
+        }
+
+        clock_gettime(CLOCK_MONOTONIC, &p.due);
+        p.due.tv_sec += delay / 1000;
+        p.due.tv_nsec += (long)(delay % 1000) * 1000000;
+        if (p.due.tv_nsec >= 1000000000)
+        {
+            p.due.tv_sec++;
+            p.due.tv_nsec -= 1000000000;
+        }
+        p.peer = peer;
+        pending[pending_count++] = p;
+    }
+
+    printf("dns-stub: запросов %lu, потеряно %lu\n", queries, dropped);
+    close(sock);
+    return 0;
+}
+
+// gcc -o dns-stub tools/dns-stub.c
@@ -0,0 +1,70 @@
+#!/bin/sh
+# Запускает сервер на синтетических фикстурах без доступа к сети:
+# заглушка DNS + сгенерированная MMDB, затем проверка ответов и нагрузочный прогон.
+#
+# Использование: tools/fixture-bench.sh [запросов] [потоков]
+# Компилятор и флаги можно переопределить через CC, CFLAGS и LDFLAGS.
+# IO_BACKENDS задает сравниваемые механизмы ввода-вывода (по умолчанию "sockets uring"),
+# SERVER_ARGS - дополнительные параметры сервера (например, "--workers 4").
+
+set -e
+
+CC=${CC:-gcc}
+REQUESTS=${1:-2000}
+CONCURRENCY=${2:-4}
+DNS_PORT=${DNS_PORT:-5353}
+IO_BACKENDS=${IO_BACKENDS:-sockets uring}
+ROOT=$(cd "$(dirname "$0")/.." && pwd)
+WORK=$(mktemp -d)
+SOCKET="$WORK/server.sock"
+
+cleanup() {
+    [ -n "$SERVER_PID" ] && kill "$SERVER_PID" 2>/dev/null
+    [ -n "$STUB_PID" ] && kill "$STUB_PID" 2>/dev/null
+    rm -rf "$WORK"
+}
+trap cleanup EXIT INT TERM
+
+$CC $CFLAGS -O2 -o "$WORK/dns-stub" "$ROOT/tools/dns-stub.c"
+$CC $CFLAGS -O2 -o "$WORK/mmdb-fixture" "$ROOT/tools/mmdb-fixture.c"
+$CC $CFLAGS -O2 -o "$WORK/bench-client" "$ROOT/tools/bench-client.c" -lpthread
+$CC $CFLAGS -O2 -o "$WORK/unix-server" "$ROOT"/*.c $LDFLAGS -lmaxminddb -ljson-c -lz -lpthread
+
+"$WORK/mmdb-fixture" "$ROOT/tools/fixtures/networks.txt" "$WORK/fixture.mmdb"
+
+"$WORK/dns-stub" -f "$ROOT/tools/fixtures/answers.txt" -p "$DNS_PORT" > "$WORK/dns-stub.log" 2>&1 &
+STUB_PID=$!
+
+start_server() {
+    GEO_DB_PATH="$WORK/fixture.mmdb" DNS_SERVER="127.0.0.1:$DNS_PORT" SERVER_SOCKET="$SOCKET" \
+        "$WORK/unix-server" --snapshot "$WORK/cache.snap" $SERVER_ARGS "$@" > "$WORK/server.log" 2>&1 &
+    SERVER_PID=$!
+
+    # Ждем появления сокета
+    for i in 1 2 3 4 5 6 7 8 9 10; do
+        [ -S "$SOCKET" ] && break
+        sleep 0.2
+    done
+}
+
+# Останавливает сервер и печатает его статистику системных вызовов на запрос
+stop_server() {
+    kill "$SERVER_PID"
+    wait "$SERVER_PID" || true
+    SERVER_PID=
+    grep -a "на запрос" "$WORK/server.log" || true
+}
+
+start_server
+echo "== Проверка ответов"
+# По одному запросу на каждую строку фикстур
+CHECKS=$(grep -vc '^#' "$ROOT/tools/fixtures/domains.txt")
+"$WORK/bench-client" -f "$ROOT/tools/fixtures/domains.txt" -s "$SOCKET" -n "$CHECKS" -c 1 -e
+stop_server > /dev/null
+
+for BACKEND in $IO_BACKENDS; do
+    start_server --io-backend "$BACKEND"
+    echo "== Нагрузка ($BACKEND): $REQUESTS запросов, $CONCURRENCY потоков"
+    "$WORK/bench-client" -f "$ROOT/tools/fixtures/domains.txt" -s "$SOCKET" -n "$REQUESTS" -c "$CONCURRENCY"
+    stop_server
+done
@@ -0,0 +1,453 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <arpa/inet.h>
+
+/**
+ * @file mmdb-fixture.c
+ * @brief Генератор маленькой синтетической базы MMDB для тестов без GeoLite2.
+ *
+ * Читает список сетей и пишет IPv4-базу в формате MaxMind DB 2.0
+ * (record_size 24), совместимую с `libmaxminddb` и структурой GeoLite2-City.
+ * Формат строки входного файла:
+ *
+ *     93.184.216.0/24 US [Los_Angeles 34.05 -118.24] [tz=America/Los_Angeles] [asn=15133 org=Edgecast]
+ *
+ * Необязательные поля - город (подчеркивания заменяются пробелами) и координаты,
+ * затем в любом порядке часовой пояс (`location.time_zone`), номер и организация
+ * автономной системы (как в GeoLite2-ASN, на верхнем уровне записи).
+ * Более специфичные сети перекрывают более общие независимо от порядка строк.
+ *
+ * Запуск: `mmdb-fixture networks.txt fixture.mmdb`
+ */
+
+#define MAX_NETWORKS 65536
+#define MAX_RECORDS 4096
+
+/**
+ * @brief Сеть из входного файла.
+ */
+typedef struct
+{
+    uint32_t ip;    /**< Адрес сети в порядке байтов хоста. */
+    int prefix;     /**< Длина префикса. */
+    int record;     /**< Индекс записи данных. */
+} Network;
+
+/**
+ * @brief Данные записи из строки входного файла (NULL - поля нет).
+ */
+typedef struct
+{
+    const char *iso;
+    const char *city;
+    const char *lat;
+    const char *lon;
+    const char *time_zone;
+    const char *asn;
+    const char *org;
+} RecordSpec;
+
+/**
+ * @brief Узел дерева поиска. Запись >= 0 - узел, -1 - пусто, <= -2 - данные.
+ */
+typedef struct
+{
+    long rec[2];
+} Node;
+
+/**
+ * @brief Динамический буфер для секции данных и метаданных.
+ */
+typedef struct
+{
+    unsigned char *data;
+    size_t len;
+    size_t cap;
+} Buf;
+
+static Network networks[MAX_NETWORKS];
+static int network_count = 0;
+static char *record_keys[MAX_RECORDS];
+static uint32_t record_offsets[MAX_RECORDS];
+static int record_count = 0;
+static Node *nodes = NULL;
+static long node_count = 0;
+static long node_cap = 0;
+
+static void buf_put(Buf *b, const void *p, size_t n)
+{
+    if (b->len + n > b->cap)
+    {
+        b->cap = (b->len + n) * 2;
+        b->data = realloc(b->data, b->cap);
+        if (b->data == NULL)
+        {
+            perror("realloc");
+            exit(EXIT_FAILURE);
+        }
+    }
+    memcpy(b->data + b->len, p, n);
+    b->len += n;
+}
+
+static void buf_byte(Buf *b, unsigned char c)
+{
+    buf_put(b, &c, 1);
+}
+
+/**
+ * @brief Пишет управляющий байт MMDB с типом и размером поля.
+ */
+static void put_control(Buf *b, int type, size_t size)
+{
+    unsigned char ctrl = type <= 7 ? (unsigned char)(type << 5) : 0;
+    unsigned char ext[3];
+    int ext_len = 0;
+
+    if (size < 29)
+        ctrl |= (unsigned char)size;
+    else if (size < 285)
+    {
+        ctrl |= 29;
+        ext[ext_len++] = (unsigned char)(size - 29);
+    }
+    else if (size < 65821)
+    {
+        ctrl |= 30;
+        ext[ext_len++] = (unsigned char)((size - 285) >> 8);
+        ext[ext_len++] = (unsigned char)(size - 285);
+    }
+    else
+    {
+        ctrl |= 31;
+        ext[ext_len++] = (unsigned char)((size - 65821) >> 16);
+        ext[ext_len++] = (unsigned char)((size - 65821) >> 8);
+        ext[ext_len++] = (unsigned char)(size - 65821);
+    }
+
+    buf_byte(b, ctrl);
+    if (type > 7)
+        buf_byte(b, (unsigned char)(type - 7));
+    buf_put(b, ext, ext_len);
+}
+
+static void put_string(Buf *b, const char *s)
+{
+    put_control(b, 2, strlen(s));
+    buf_put(b, s, strlen(s));
+}
+
+static void put_uint(Buf *b, int type, uint64_t v)
+{
+    unsigned char bytes[8];
+    int n = 0;
+
+    for (int shift = 56; shift >= 0; shift -= 8)
+    {
+        unsigned char c = (unsigned char)(v >> shift);
+        if (n > 0 || c != 0)
+            bytes[n++] = c;
+    }
+    put_control(b, type, n);
+    buf_put(b, bytes, n);
+}
+
+static void put_double(Buf *b, double d)
+{
+    uint64_t bits;
+    unsigned char bytes[8];
+
+    memcpy(&bits, &d, sizeof(bits));
+    for (int i = 0; i < 8; i++)
+        bytes[i] = (unsigned char)(bits >> (56 - 8 * i));
+    put_control(b, 3, 8);
+    buf_put(b, bytes, 8);
+}
+
+/**
+ * @brief Пишет название, заменяя подчеркивания пробелами.
+ */
+static void put_name(Buf *b, const char *s)
+{
+    char name[1024];
+
+    snprintf(name, sizeof(name), "%s", s);
+    for (char *p = name; *p; p++)
+    {
+        if (*p == '_')
+            *p = ' ';
+    }
+    put_string(b, name);
+}
+
+#define OPT(s) ((s) ? (s) : "")
+
+/**
+ * @brief Кодирует запись в стиле GeoLite2-City и возвращает ее индекс (с дедупликацией).
+ */
+static int add_record(Buf *data, const RecordSpec *spec)
+{
+    char key[2048];
+    int has_location = spec->lat != NULL && spec->lon != NULL;
+
+    snprintf(key, sizeof(key), "%s|%s|%s|%s|%s|%s|%s", spec->iso, OPT(spec->city), OPT(spec->lat), OPT(spec->lon),
+             OPT(spec->time_zone), OPT(spec->asn), OPT(spec->org));
+    for (int i = 0; i < record_count; i++)
+    {
+        if (strcmp(record_keys[i], key) == 0)
+            return i;
+    }
+    if (record_count == MAX_RECORDS)
+    {
+        fprintf(stderr, "mmdb-fixture: слишком много различных записей\n");
+        exit(EXIT_FAILURE);
+    }
+
+    record_keys[record_count] = strdup(key);
+    record_offsets[record_count] = (uint32_t)data->len;
+
+    int location_size = 2 * has_location + (spec->time_zone != NULL);
+    put_control(data, 7, 1 + (spec->city != NULL) + (location_size > 0) + (spec->asn != NULL) + (spec->org != NULL));
+    if (spec->city != NULL)
+    {
+        put_string(data, "city");
+        put_control(data, 7, 1);
+        put_string(data, "names");
+        put_control(data, 7, 1);
+        put_string(data, "en");
+        put_name(data, spec->city);
+    }
+    put_string(data, "country");
+    put_control(data, 7, 1);
+    put_string(data, "iso_code");
+    put_string(data, spec->iso);
+    if (location_size > 0)
+    {
+        put_string(data, "location");
+        put_control(data, 7, location_size);
+        if (has_location)
+        {
+            put_string(data, "latitude");
+            put_double(data, atof(spec->lat));
+            put_string(data, "longitude");
+            put_double(data, atof(spec->lon));
+        }
+        if (spec->time_zone != NULL)
+        {
+            put_string(data, "time_zone");
+            put_string(data, spec->time_zone);
+        }
+    }
+    if (spec->asn != NULL)
+    {
+        put_string(data, "autonomous_system_number");
+        put_uint(data, 6, strtoull(spec->asn, NULL, 10));
+    }
+    if (spec->org != NULL)
+    {
+        put_string(data, "autonomous_system_organization");
+        put_name(data, spec->org);
+    }
+
+    return record_count++;
+}
+
+static long new_node(long fill)
+{
+    if (node_count == node_cap)
+    {
+        node_cap = node_cap ? node_cap * 2 : 1024;
+        nodes = realloc(nodes, node_cap * sizeof(Node));
+        if (nodes == NULL)
+        {
+            perror("realloc");
+            exit(EXIT_FAILURE);
+        }
+    }
+    nodes[node_count].rec[0] = fill;
+    nodes[node_count].rec[1] = fill;
+    return node_count++;
+}
+
+/**
+ * @brief Вставляет сеть в дерево. Сети должны идти по возрастанию длины префикса.
+ */
+static void insert_network(const Network *net)
+{
+    long node = 0;
+
+    for (int depth = 0; depth < net->prefix; depth++)
+    {
+        int bit = (net->ip >> (31 - depth)) & 1;
+        if (depth == net->prefix - 1)
+        {
+            nodes[node].rec[bit] = -2 - net->record;
+            return;
+        }
+        if (nodes[node].rec[bit] < 0)
+        {
+            // Пустая запись или более общая сеть - расщепляем ее на узел
+            long child = new_node(nodes[node].rec[bit]);
+            nodes[node].rec[bit] = child;
+        }
+        node = nodes[node].rec[bit];
+    }
+}
+
+static int by_prefix(const void *a, const void *b)
+{
+    return ((const Network *)a)->prefix - ((const Network *)b)->prefix;
+}
+
+static uint32_t encode_record(long rec)
+{
+    if (rec >= 0)
+        return (uint32_t)rec;
+    if (rec == -1)
+        return (uint32_t)node_count;
+    return (uint32_t)(node_count + 16 + record_offsets[-2 - rec]);
+}
+
+static void put_metadata(Buf *meta)
+{
+    buf_put(meta, "\xAB\xCD\xEFMaxMind.com", 14);
+    put_control(meta, 7, 9);
+    put_string(meta, "binary_format_major_version");
+    put_uint(meta, 5, 2);
+    put_string(meta, "binary_format_minor_version");
+    put_uint(meta, 5, 0);
+    put_string(meta, "build_epoch");
+    put_uint(meta, 9, (uint64_t)time(NULL));
+    put_string(meta, "database_type");
+    put_string(meta, "GeoLite2-City");
+    put_string(meta, "description");
+    put_control(meta, 7, 1);
+    put_string(meta, "en");
+    put_string(meta, "Synthetic fixture for unix-server tests");
+    put_string(meta, "ip_version");
+    put_uint(meta, 5, 4);
+    put_string(meta, "languages");
+    put_control(meta, 11, 1);
+    put_string(meta, "en");
+    put_string(meta, "node_count");
+    put_uint(meta, 6, (uint64_t)node_count);
+    put_string(meta, "record_size");
+    put_uint(meta, 5, 24);
+}
+
+int main(int argc, char *argv[])
+{
+    FILE *in;
+    FILE *out;
+    char line[2048];
+    Buf data = {0};
+    Buf meta = {0};
+    static const unsigned char separator[16] = {0};
+
+    if (argc != 3)
+    {
+        fprintf(stderr, "Использование: %s networks.txt fixture.mmdb\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    in = fopen(argv[1], "r");
+    if (in == NULL)
+    {
+        perror("fopen");
+        return EXIT_FAILURE;
+    }
+
+    while (fgets(line, sizeof(line), in) != NULL && network_count < MAX_NETWORKS)
+    {
+        // Позиционные поля: сеть, ISO, город, широта, долгота; остальное - key=value
+        char *positional[5];
+        int fields = 0;
+        RecordSpec spec = {0};
+        struct in_addr addr;
+        char *slash;
+
+        for (char *token = strtok(line, " \t\r\n"); token != NULL; token = strtok(NULL, " \t\r\n"))
+        {
+            if (strncmp(token, "tz=", 3) == 0)
+                spec.time_zone = token + 3;
+            else if (strncmp(token, "asn=", 4) == 0)
+                spec.asn = token + 4;
+            else if (strncmp(token, "org=", 4) == 0)
+                spec.org = token + 4;
+            else if (fields < 5)
+                positional[fields++] = token;
+        }
+
+        if (fields < 2 || positional[0][0] == '#')
+            continue;
+
+        char *cidr = positional[0];
+        spec.iso = positional[1];
+        spec.city = fields >= 3 ? positional[2] : NULL;
+        spec.lat = fields >= 5 ? positional[3] : NULL;
+        spec.lon = fields >= 5 ? positional[4] : NULL;
+
+        slash = strchr(cidr, '/');
+        if (slash != NULL)
+            *slash = '\0';
+        if (inet_pton(AF_INET, cidr, &addr) != 1)
+        {
+            fprintf(stderr, "mmdb-fixture: некорректная сеть '%s'\n", cidr);
+            continue;
+        }
+
+        Network *net = &networks[network_count++];
+        net->prefix = slash != NULL ? atoi(slash + 1) : 32;
+        if (net->prefix < 1 || net->prefix > 32)
+            net->prefix = 32;
+        net->ip = ntohl(addr.s_addr);
+        net->record = add_record(&data, &spec);
+    }
+    fclose(in);
+
+    qsort(networks, network_count, sizeof(Network), by_prefix);
+    new_node(-1);
+    for (int i = 0; i < network_count; i++)
+        insert_network(&networks[i]);
+
+    put_metadata(&meta);
+
+    out = fopen(argv[2], "wb");
+    if (out == NULL)
+    {
+        perror("fopen");
+        return EXIT_FAILURE;
+    }
+
+    // Дерево поиска: по 3 байта (big-endian) на левую и правую запись
+    for (long i = 0; i < node_count; i++)
+    {
+        unsigned char rec[6];
+        for (int side = 0; side < 2; side++)
+        {
+            uint32_t v = encode_record(nodes[i].rec[side]);
+            rec[side * 3] = (unsigned char)(v >> 16);
+            rec[side * 3 + 1] = (unsigned char)(v >> 8);
+            rec[side * 3 + 2] = (unsigned char)v;
+        }
+        fwrite(rec, 1, sizeof(rec), out);
+    }
+    fwrite(separator, 1, sizeof(separator), out);
+    fwrite(data.data, 1, data.len, out);
+    fwrite(meta.data, 1, meta.len, out);
+    fclose(out);
+
+    printf("mmdb-fixture: %d сетей, %d записей, %ld узлов -> %s\n", network_count, record_count, node_count, argv[2]);
+
+    for (int i = 0; i < record_count; i++)
+        free(record_keys[i]);
+    free(nodes);
+    free(data.data);
+    free(meta.data);
+    return 0;
+}
+
+// gcc -o mmdb-fixture tools/mmdb-fixture.c
@@ -0,0 +1,78 @@
+#!/bin/sh
+# Проверяет масштабирование режима --shards: прогоняет нагрузку на 1, 2, 4, ... шардах
+# (до числа доступных ядер) и печатает пропускную способность и ускорение относительно
+# одного шарда. Сервер работает на фикстурах, как в tools/fixture-bench.sh.
+#
+# Использование: tools/shard-bench.sh [запросов на шард] [потоков на шард]
+# SHARD_COUNTS задает список количеств шардов (по умолчанию степени двойки до nproc),
+# SERVER_ARGS - дополнительные параметры сервера (например, "--io-backend uring").
+# Клиент нагрузки тоже занимает ядра, поэтому на шаге, где шарды заняли все ядра,
+# рост упирается в него; для чистого замера ограничьте сервер через taskset, оставив
+# клиенту отдельные ядра.
+
+set -e
+
+CC=${CC:-gcc}
+REQUESTS=${1:-20000}
+CONCURRENCY=${2:-8}
+DNS_PORT=${DNS_PORT:-5353}
+CPUS=$(nproc)
+ROOT=$(cd "$(dirname "$0")/.." && pwd)
+WORK=$(mktemp -d)
+SOCKET="$WORK/server.sock"
+
+if [ -z "$SHARD_COUNTS" ]; then
+    SHARD_COUNTS=1
+    N=2
+    while [ "$N" -lt "$CPUS" ]; do
+        SHARD_COUNTS="$SHARD_COUNTS $N"
+        N=$((N * 2))
+    done
+    [ "$CPUS" -gt 1 ] && SHARD_COUNTS="$SHARD_COUNTS $CPUS"
+fi
+
+cleanup() {
+    [ -n "$SERVER_PID" ] && kill "$SERVER_PID" 2>/dev/null
+    [ -n "$STUB_PID" ] && kill "$STUB_PID" 2>/dev/null
+    rm -rf "$WORK"
+}
+trap cleanup EXIT INT TERM
+
+$CC $CFLAGS -O2 -o "$WORK/dns-stub" "$ROOT/tools/dns-stub.c"
+$CC $CFLAGS -O2 -o "$WORK/mmdb-fixture" "$ROOT/tools/mmdb-fixture.c"
+$CC $CFLAGS -O2 -o "$WORK/bench-client" "$ROOT/tools/bench-client.c" -lpthread
+$CC $CFLAGS -O2 -o "$WORK/unix-server" "$ROOT"/*.c $LDFLAGS -lmaxminddb -ljson-c -lz -lpthread
+
+"$WORK/mmdb-fixture" "$ROOT/tools/fixtures/networks.txt" "$WORK/fixture.mmdb"
+
+"$WORK/dns-stub" -f "$ROOT/tools/fixtures/answers.txt" -p "$DNS_PORT" > "$WORK/dns-stub.log" 2>&1 &
+STUB_PID=$!
+
+BASE=
+echo "шардов   запр/с       ускорение  эффективность"
+for SHARDS in $SHARD_COUNTS; do
+    # Снимки и отладочный вывод не должны влиять на замер
+    GEO_DB_PATH="$WORK/fixture.mmdb" DNS_SERVER="127.0.0.1:$DNS_PORT" SERVER_SOCKET="$SOCKET" \
+        "$WORK/unix-server" --snapshot-interval 0 --shards "$SHARDS" $SERVER_ARGS > /dev/null 2>&1 &
+    SERVER_PID=$!
+    for i in 1 2 3 4 5 6 7 8 9 10; do
+        [ -S "$SOCKET" ] && break
+        sleep 0.2
+    done
+
+    # Прогрев: каждый шард заполняет свой кэш, замеряются только попадания
+    "$WORK/bench-client" -f "$ROOT/tools/fixtures/domains.txt" -s "$SOCKET" \
+        -n $((REQUESTS * SHARDS / 4)) -c $((CONCURRENCY * SHARDS)) > /dev/null
+    RATE=$("$WORK/bench-client" -f "$ROOT/tools/fixtures/domains.txt" -s "$SOCKET" \
+        -n $((REQUESTS * SHARDS)) -c $((CONCURRENCY * SHARDS)) |
+        sed -n 's/.*пропускная способность: \([0-9.]*\).*/\1/p')
+
+    kill "$SERVER_PID"
+    wait "$SERVER_PID" || true
+    SERVER_PID=
+    rm -f "$SOCKET"
+
+    [ -z "$BASE" ] && BASE=$RATE
+    awk -v n="$SHARDS" -v r="$RATE" -v b="$BASE" \
+        'BEGIN { printf "%-8d %-12.0f %-10.2f %.0f%%\n", n, r, r / b, 100 * r / b / n }'
+done
@@ -0,0 +1,78 @@
+#include <stdio.h>
+#include <time.h>
+
+#include "trace.h"
+#include "admission.h"
+
+static int trace_enabled = 0;
+
+static __thread int active = 0;                 /**< Трассируется ли текущий запрос потока. */
+static __thread uint64_t started_at = 0;        /**< Начало обработки запроса, нс. */
+static __thread long waited_ms = 0;             /**< Ожидание от accept до начала обработки. */
+static __thread uint64_t stage_ns[TRACE_STAGES];
+
+/** Имена стадий в `Server-Timing` (для TRACE_LOOKUP выводится остаток без DNS и MMDB). */
+static const char *const stage_names[TRACE_STAGES] = {"cache", "dns", "geo", "fields", "body"};
+
+static uint64_t monotonic_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+void trace_configure(int enabled)
+{
+    trace_enabled = enabled;
+}
+
+void trace_begin(void)
+{
+    if (!trace_enabled)
+        return;
+
+    active = 1;
+    for (int i = 0; i < TRACE_STAGES; i++)
+        stage_ns[i] = 0;
+    waited_ms = admission_waited_ms();
+    started_at = monotonic_ns();
+}
+
+uint64_t trace_now(void)
+{
+    return active ? monotonic_ns() : 0;
+}
+
+void trace_add(TraceStage stage, uint64_t started)
+{
+    // started == 0: трассировка началась позже отметки (например, фоновое обновление)
+    if (active && started != 0)
+        stage_ns[stage] += monotonic_ns() - started;
+}
+
+int trace_header(char *header, size_t size)
+{
+    if (!active)
+        return 0;
+    active = 0;
+
+    uint64_t total = monotonic_ns() - started_at;
+
+    // Поиск домена включает DNS и MMDB, в `cache` остается только работа с кэшами
+    uint64_t nested = stage_ns[TRACE_DNS] + stage_ns[TRACE_GEO];
+    stage_ns[TRACE_LOOKUP] = stage_ns[TRACE_LOOKUP] > nested ? stage_ns[TRACE_LOOKUP] - nested : 0;
+
+    int len = snprintf(header, size, "Server-Timing: ");
+    if (waited_ms > 0 && len >= 0 && (size_t)len < size)
+        len += snprintf(header + len, size - len, "queue;dur=%ld, ", waited_ms);
+    for (int i = 0; i < TRACE_STAGES && len >= 0 && (size_t)len < size; i++)
+    {
+        if (stage_ns[i] != 0)
+            len += snprintf(header + len, size - len, "%s;dur=%.3f, ", stage_names[i], stage_ns[i] / 1e6);
+    }
+    if (len >= 0 && (size_t)len < size)
+        len += snprintf(header + len, size - len, "total;dur=%.3f\r\n", total / 1e6);
+
+    return len >= 0 && (size_t)len < size ? len : 0;
+}
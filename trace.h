@@ -0,0 +1,59 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief Стадии обработки запроса для заголовка `Server-Timing`.
+ */
+typedef enum
+{
+    TRACE_LOOKUP, /**< Весь поиск домена (`lookup_domain`), включая DNS и MMDB. */
+    TRACE_DNS,    /**< Запрос к DNS (`get_dns_info_ttl`). */
+    TRACE_GEO,    /**< Поиск страны в MMDB (`get_geo_info`). */
+    TRACE_FIELDS, /**< Дополнительные поля геобазы (`geo_fields_format`). */
+    TRACE_BODY,   /**< Сборка и сжатие тела ответа. */
+    TRACE_STAGES
+} TraceStage;
+
+/**
+ * @brief Включает режим трассировки запросов (`--server-timing`).
+ *
+ * Вызывается до запуска обработчиков. В выключенном режиме остальные функции
+ * модуля сводятся к проверке одного флага.
+ */
+void trace_configure(int enabled);
+
+/**
+ * @brief Начинает трассировку запроса в текущем потоке.
+ *
+ * Время ожидания в очереди берется от accept (`admission_waited_ms`), поэтому
+ * вызывается после `admission_begin`.
+ */
+void trace_begin(void);
+
+/**
+ * @brief Текущее монотонное время в наносекундах или 0, если запрос не трассируется.
+ */
+uint64_t trace_now(void);
+
+/**
+ * @brief Добавляет к стадии время, прошедшее с `started` (результат `trace_now`).
+ */
+void trace_add(TraceStage stage, uint64_t started);
+
+/**
+ * @brief Формирует заголовок `Server-Timing` и завершает трассировку запроса.
+ *
+ * Стадии не пересекаются: `cache` - поиск домена без DNS и MMDB, `queue` -
+ * ожидание от accept до начала обработки, `total` - время обработки без
+ * ожидания. Стадии с нулевым временем пропускаются.
+ *
+ * @param header Буфер для заголовка (вместе с `\r\n`).
+ * @param size Размер буфера.
+ * @return Длина заголовка или 0, если запрос не трассируется или заголовок не поместился.
+ */
+int trace_header(char *header, size_t size);
+
+#endif // TRACE_H
@@ -9,6 +9,9 @@
 #include <sys/stat.h>  // Для chmod
 #include <regex.h>
 #include <arpa/inet.h>
+#include <getopt.h>
+#include <signal.h>
+#include <errno.h>
 
 #include <maxminddb.h> // Для работы с libmaxminddb
 
@@ -17,6 +20,23 @@
 #include "flags.h"
 #include "geo_lookup.h"
 #include "unix-server.h"
+#include "batch.h"
+#include "domain_cache.h"
+#include "shared_cache.h"
+#include "prefork.h"
+#include "uring_server.h"
+#include "flag_store.h"
+#include "precompressed.h"
+#include "upgrade.h"
+#include "admission.h"
+#include "peer_limit.h"
+#include "socket_server.h"
+#include "shard.h"
+#include "hot_cache.h"
+#include "domain_name.h"
+#include "geo_fields.h"
+#include "trace.h"
+#include "probes.h"
 
 #define SOCKET_PATH "/tmp/myserver.sock"
 #define BUFFER_SIZE 1024
@@ -24,13 +44,232 @@
 // Количество элементов в массиве флагов
 #define FLAGS_COUNT (sizeof(flags) / sizeof(flags[0]))
 
-int main()
+/** Ответ на запрос с некорректным именем домена. */
+static const char RESPONSE_BAD_DOMAIN[] =
+    "HTTP/1.1 400 Bad Request\r\n"
+    "Content-Type: application/json\r\n"
+    "Content-Length: 28\r\n"
+    "Access-Control-Allow-Origin: *\r\n"
+    "Connection: close\r\n"
+    "\r\n"
+    "{\"error\": \"invalid domain\"}\n";
+
+/** Ответ на запрос с неизвестным полем в `fields=`. */
+static const char RESPONSE_BAD_FIELDS[] =
+    "HTTP/1.1 400 Bad Request\r\n"
+    "Content-Type: application/json\r\n"
+    "Content-Length: 28\r\n"
+    "Access-Control-Allow-Origin: *\r\n"
+    "Connection: close\r\n"
+    "\r\n"
+    "{\"error\": \"invalid fields\"}\n";
+
+/** Адрес DNS-сервера для `dig` в формате `host` или `host:port` (NULL - системный резолвер). */
+static const char *dns_server = NULL;
+
+/** Печатать ли отладочные сообщения о запросах (в пакетном режиме отключается). */
+static int verbose = 1;
+
+/** Как отдавать флаг в JSON по умолчанию: встроенным base64 или ссылкой на /flag/<ISO>.png. */
+static FlagMode flag_mode = FLAG_MODE_INLINE;
+
+/** Режим --shards: рабочие процессы привязаны к ядрам и не читают общий кэш. */
+static int sharded = 0;
+
+/** Таймауты медленных клиентов и предел соединений (--header-timeout и др.). */
+static ConnectionLimits connection_limits;
+
+/** Выставляется обработчиком SIGINT/SIGTERM для корректного завершения. */
+static volatile sig_atomic_t stop_requested = 0;
+
+/** Получен SIGINT/SIGTERM: выходить, даже если обновление не удалось. */
+static volatile sig_atomic_t terminate_requested = 0;
+
+/** Получен SIGUSR2: передать слушающий сокет новой версии сервера. */
+static volatile sig_atomic_t upgrade_requested = 0;
+
+static void on_stop_signal(int sig)
+{
+    (void)sig;
+    terminate_requested = 1;
+    stop_requested = 1;
+}
+
+static void on_upgrade_signal(int sig)
+{
+    (void)sig;
+    upgrade_requested = 1;
+    stop_requested = 1;
+}
+
+/** Слушающий сокет передан новой версии из цикла обслуживания (однопроцессный режим). */
+static int socket_handed_over = 0;
+
+/**
+ * @brief Формирует ответ для циклов обслуживания соединений (arg - `ServeContext`).
+ */
+static char *respond(const char *request, size_t *response_len, void *arg)
+{
+    const ServeContext *ctx = arg;
+
+    return build_response(request, ctx->mmdb, response_len);
+}
+
+/**
+ * @brief Обслуживает соединения выбранным механизмом ввода-вывода.
+ *
+ * Если io_uring недоступен, переходит на обычные блокирующие сокеты.
+ * `shared_listener` означает, что слушающий сокет делят несколько процессов.
+ * `on_stop` вызывается циклом при остановке до дренажа (NULL - не нужна).
+ */
+static void serve(const ServeContext *ctx, int shared_listener, SocketStopFn on_stop)
+{
+    if (ctx->options->io_backend == IO_BACKEND_URING)
+    {
+        // Несколько процессов на одном сокете: multishot accept собрал бы соединения в занятом процессе
+        if (uring_serve(ctx->server_sock, !shared_listener, &connection_limits, respond, (void *)ctx,
+                        &stop_requested, on_stop) == 0)
+            return;
+        fprintf(stderr, "io_uring недоступен, используются обычные сокеты\n");
+    }
+    serve_connections(ctx, on_stop);
+}
+
+/**
+ * @brief Копирует запись кэша в общий кэш (для обхода через foreach).
+ */
+static void copy_to_shared(const DomainCacheRecord *record, void *arg)
+{
+    (void)arg;
+    shared_cache_put(record);
+}
+
+/**
+ * @brief Копирует запись общего кэша в локальный кэш (для обхода через foreach).
+ */
+static void copy_to_local(const DomainCacheRecord *record, void *arg)
+{
+    (void)arg;
+    domain_cache_put_record(record);
+}
+
+/**
+ * @brief Главная функция рабочего процесса в режимах --workers и --shards.
+ */
+static int worker_main(int worker_id, void *arg)
 {
-    char *db_path = "./GeoLite2-City.mmdb";
+    ServeContext *ctx = arg;
+
+    // Обновление запускает только мастер
+    signal(SIGUSR2, SIG_IGN);
+
+    // Привязываемся к ядру до запуска потоков: они унаследуют привязку
+    if (sharded)
+    {
+        int cpu = shard_pin(worker_id);
+        if (cpu >= 0)
+            printf("Шард %d закреплен за ядром %d\n", worker_id, cpu);
+        fflush(stdout);
+    }
+
+    // Потоки не переживают fork, поэтому фоновое обновление запускается в каждом процессе
+    domain_cache_start_refresher(ctx->options->refresh_window, ctx->options->refresh_min_hits,
+                                 refresh_domain, (void *)ctx->mmdb);
+    serve(ctx, 1, NULL);
+    domain_cache_stop_refresher();
+    return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Периодическая задача мастера: переносит общий кэш в локальный и пишет снимок.
+ */
+static void snapshot_from_shared(void *arg)
+{
+    ServeContext *ctx = arg;
+
+    shared_cache_foreach(copy_to_local, NULL);
+    domain_cache_purge_expired();
+    domain_cache_save(ctx->options->snapshot_path);
+}
+
+/**
+ * @brief Записывает кэш для новой версии сервера (вместе с общим кэшем рабочих).
+ */
+static long write_upgrade_state(int fd, void *arg)
+{
+    (void)arg;
+
+    if (shared_cache_enabled())
+        shared_cache_foreach(copy_to_local, NULL);
+    return domain_cache_save_fd(fd);
+}
+
+/**
+ * @brief Передает слушающий сокет и кэш новой версии сервера.
+ */
+static int hand_over(void *arg)
+{
+    ServeContext *ctx = arg;
+
+    return upgrade_spawn(ctx->server_sock, write_upgrade_state, NULL);
+}
+
+/**
+ * @brief Передает сокет по SIGUSR2 из цикла обслуживания, до дренажа соединений.
+ *
+ * Пока новая версия запускается, сокет остается за этим процессом, а после ее
+ * подтверждения она сразу принимает соединения из очереди сокета, не дожидаясь,
+ * пока этот процесс дообслужит открытые. Если новая версия не запустилась,
+ * остановка отменяется (кроме случая, когда пришел и SIGINT/SIGTERM).
+ */
+static void hand_over_before_drain(void *arg)
+{
+    if (!upgrade_requested)
+        return;
+
+    upgrade_requested = 0;
+    if (hand_over(arg) == 0)
+    {
+        socket_handed_over = 1;
+        return;
+    }
+    stop_requested = terminate_requested;
+}
+
+int main(int argc, char *argv[])
+{
+    const char *db_path = DEFAULT_DB_PATH;
+    const char *socket_path = SOCKET_PATH;
     int server_sock;
+    int state_fd;
+    int upgrading;
+    int handed_over = 0;
     struct sockaddr_un server_addr;
     MMDB_s mmdb;
     int mmdb_error;
+    ServerOptions options;
+
+    if (parse_options(argc, argv, &options) < 0)
+        return EXIT_FAILURE;
+
+    // Путь к исполняемому файлу запоминаем до того, как его заменят при выкладке
+    upgrade_init(argv);
+
+    // SIGUSR2 - передать сокет новой версии без закрытия и удаления с диска. Обработчик ставим
+    // до медленных шагов запуска: иначе SIGUSR2 от инструмента выкладки завершил бы процесс.
+    // Пришедший до начала обслуживания сигнал выполняется, как только запустится цикл
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = on_upgrade_signal;
+    sigaction(SIGUSR2, &sa, NULL);
+
+    // Путь к базе и DNS-сервер можно переопределить через окружение,
+    // например, чтобы указать на тестовые фикстуры из каталога tools/
+    if (getenv("GEO_DB_PATH") != NULL)
+        db_path = getenv("GEO_DB_PATH");
+    if (getenv("SERVER_SOCKET") != NULL)
+        socket_path = getenv("SERVER_SOCKET");
+    dns_server = getenv("DNS_SERVER");
 
     // Открываем базу данных GeoLite2
     mmdb_error = MMDB_open(db_path, 0, &mmdb);
@@ -40,66 +279,225 @@ int main()
         return EXIT_FAILURE;
     }
 
-    // Создаем Unix-сокет
-    server_sock = socket(AF_UNIX, SOCK_STREAM, 0);
-    if (server_sock < 0)
+    // Пакетный режим: обрабатываем файл доменов и выходим, не открывая сокет
+    if (options.batch_file != NULL)
     {
-        perror("socket");   // Печатаем сообщение об ошибке, если создание сокета не удалась
-        MMDB_close(&mmdb);  // Закрываем MMDB перед выходом
-        exit(EXIT_FAILURE); // Завершаем программу с кодом ошибки
+        verbose = 0;
+        geo_lookup_verbose = 0;
+        int status = run_batch(options.batch_file, options.batch_format, options.batch_threads,
+                               options.batch_inflight, &mmdb);
+        MMDB_close(&mmdb);
+        return status;
     }
 
-    // Настраиваем адрес сервера
-    memset(&server_addr, 0, sizeof(server_addr));                                 // Очищаем структуру адреса
-    server_addr.sun_family = AF_UNIX;                                             // Устанавливаем семейство адресов в Unix
-    strncpy(server_addr.sun_path, SOCKET_PATH, sizeof(server_addr.sun_path) - 1); // Копируем путь к сокету
+    connection_limits.header_timeout_ms = options.header_timeout_ms;
+    connection_limits.body_timeout_ms = options.body_timeout_ms;
+    connection_limits.write_timeout_ms = options.write_timeout_ms;
+    connection_limits.max_connections = options.max_connections;
+    trace_configure(options.server_timing);
 
-    // Удаляем старый сокет, если он существует
-    unlink(SOCKET_PATH);
+    // Шард на ядро: каждый со своим accept, буферами и горячим кэшем
+    if (options.shards != 0)
+    {
+        sharded = 1;
+        options.workers = options.shards == SHARDS_AUTO ? shard_cpu_count() : options.shards;
+        hot_cache_configure(options.hot_cache_size, options.refresh_window);
+    }
 
-    // Привязываем сокет к адресу
-    if (bind(server_sock, (struct sockaddr *)&server_addr, sizeof(server_addr)) < 0)
+    // Декодируем изображения флагов один раз, чтобы отдавать их по /flag/<ISO>.png,
+    // и заранее сжимаем постоянные части ответов для каждой страны
+    flag_mode = options.flag_mode;
+    if (flag_store_init(flags, FLAGS_COUNT) < 0 || precompressed_init(flags, FLAGS_COUNT) < 0)
     {
-        perror("bind");     // Печатаем сообщение об ошибке, если привязка сокета не удалась
-        close(server_sock); // Закрываем сокет
-        MMDB_close(&mmdb);  // Закрываем MMDB перед выходом
-        exit(EXIT_FAILURE); // Завершаем программу с кодом ошибки
+        fprintf(stderr, "Не удалось подготовить изображения флагов\n");
+        flag_store_destroy();
+        MMDB_close(&mmdb);
+        return EXIT_FAILURE;
     }
 
-    // Пример изменения прав доступа к сокету
-    if (chmod(SOCKET_PATH, 0777) < 0)
+    // Поднимаем кэш доменов из снимка до того, как начнем принимать соединения
+    if (domain_cache_init(options.cache_size) < 0)
     {
-        perror("chmod");
+        precompressed_destroy();
+        flag_store_destroy();
+        MMDB_close(&mmdb);
+        return EXIT_FAILURE;
     }
 
-    // Слушаем входящие соединения
-    if (listen(server_sock, 5) < 0)
+    // Счетчики отказов создаются до fork, чтобы их видели все рабочие процессы
+    if (admission_init(options.queue_depth, options.deadline_ms) < 0)
     {
-        perror("listen");   // Печатаем сообщение об ошибке, если не удалось начать прослушивание
-        close(server_sock); // Закрываем сокет
-        MMDB_close(&mmdb);  // Закрываем MMDB перед выходом
-        exit(EXIT_FAILURE); // Завершаем программу с кодом ошибки
+        domain_cache_destroy();
+        precompressed_destroy();
+        flag_store_destroy();
+        MMDB_close(&mmdb);
+        return EXIT_FAILURE;
     }
 
-    // Информируем пользователя, что сервер начал слушать
-    printf("Unix-сервер слушает на сокете %s\n", SOCKET_PATH);
+    // Ведра токенов клиентов тоже общие для рабочих процессов
+    if (peer_limit_init(options.peer_limits, options.peer_limit_count) < 0)
+    {
+        admission_destroy();
+        domain_cache_destroy();
+        precompressed_destroy();
+        flag_store_destroy();
+        MMDB_close(&mmdb);
+        return EXIT_FAILURE;
+    }
 
-    // Основной цикл обработки входящих соединений
-    while (1)
+    // При обновлении сокет и кэш передает предыдущий процесс
+    upgrading = upgrade_receive(&server_sock, &state_fd);
+    if (upgrading < 0)
     {
-        int client_sock = accept(server_sock, NULL, NULL); // Принимаем входящее соединение
-        if (client_sock < 0)
+        domain_cache_destroy();
+        precompressed_destroy();
+        flag_store_destroy();
+        MMDB_close(&mmdb);
+        return EXIT_FAILURE;
+    }
+    if (state_fd >= 0)
+    {
+        long loaded = domain_cache_load_fd(state_fd, "(кэш предыдущего процесса)");
+        if (loaded >= 0)
+            printf("Получено записей кэша от предыдущего процесса: %ld\n", loaded);
+        close(state_fd);
+    }
+    else if (options.snapshot_interval > 0)
+    {
+        long loaded = domain_cache_load(options.snapshot_path);
+        if (loaded >= 0)
+            printf("Загружено записей из снимка кэша %s: %ld\n", options.snapshot_path, loaded);
+    }
+
+    if (upgrading)
+    {
+        printf("Unix-сервер принял сокет %s от предыдущего процесса\n", socket_path);
+    }
+    else
+    {
+        // Создаем Unix-сокет
+        server_sock = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (server_sock < 0)
+        {
+            perror("socket");   // Печатаем сообщение об ошибке, если создание сокета не удалась
+            MMDB_close(&mmdb);  // Закрываем MMDB перед выходом
+            exit(EXIT_FAILURE); // Завершаем программу с кодом ошибки
+        }
+
+        // Настраиваем адрес сервера
+        memset(&server_addr, 0, sizeof(server_addr));                                 // Очищаем структуру адреса
+        server_addr.sun_family = AF_UNIX;                                             // Устанавливаем семейство адресов в Unix
+        strncpy(server_addr.sun_path, socket_path, sizeof(server_addr.sun_path) - 1); // Копируем путь к сокету
+
+        // Удаляем старый сокет, если он существует
+        unlink(socket_path);
+
+        // Привязываем сокет к адресу
+        if (bind(server_sock, (struct sockaddr *)&server_addr, sizeof(server_addr)) < 0)
+        {
+            perror("bind");     // Печатаем сообщение об ошибке, если привязка сокета не удалась
+            close(server_sock); // Закрываем сокет
+            MMDB_close(&mmdb);  // Закрываем MMDB перед выходом
+            exit(EXIT_FAILURE); // Завершаем программу с кодом ошибки
+        }
+
+        // Пример изменения прав доступа к сокету
+        if (chmod(socket_path, 0777) < 0)
+        {
+            perror("chmod");
+        }
+
+        // Слушаем входящие соединения (очередь побольше, чтобы пережить всплески при нескольких рабочих)
+        if (listen(server_sock, SOMAXCONN) < 0)
         {
-            perror("accept"); // Печатаем сообщение об ошибке, если не удалось принять соединение
-            continue;         // Продолжаем цикл, не закрывая серверный сокет
+            perror("listen");   // Печатаем сообщение об ошибке, если не удалось начать прослушивание
+            close(server_sock); // Закрываем сокет
+            MMDB_close(&mmdb);  // Закрываем MMDB перед выходом
+            exit(EXIT_FAILURE); // Завершаем программу с кодом ошибки
         }
 
-        handle_client(client_sock, &mmdb); // Обрабатываем запрос клиента
-        close(client_sock);                // Закрываем соединение с клиентом
+        // Информируем пользователя, что сервер начал слушать
+        printf("Unix-сервер слушает на сокете %s\n", socket_path);
     }
 
-    // Закрываем серверный сокет
-    close(server_sock);
+    // SIGINT/SIGTERM прерывают accept (без SA_RESTART), чтобы сохранить снимок перед выходом
+    sa.sa_handler = on_stop_signal;
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+
+    // Предыдущий процесс перестает принимать соединения только после этого подтверждения
+    upgrade_ready();
+
+    if (options.workers > 1 || sharded)
+    {
+        ServeContext ctx = {server_sock, &mmdb, &options};
+
+        // Общий кэш создается до fork, чтобы все рабочие процессы отобразили одну и ту же память.
+        // Шарды только пишут в него результаты разрешения - для снимков и передачи при обновлении
+        if (shared_cache_init(options.shared_cache_size) == 0)
+            domain_cache_foreach(copy_to_shared, NULL);
+
+        // Дальше SIGUSR2 обрабатывает мастер через sigtimedwait. Пришедший во время запуска сигнал
+        // возвращаем в очередь, иначе рабочие унаследовали бы выставленный им флаг остановки
+        sigset_t upgrade_mask;
+        sigemptyset(&upgrade_mask);
+        sigaddset(&upgrade_mask, SIGUSR2);
+        sigprocmask(SIG_BLOCK, &upgrade_mask, NULL);
+        if (upgrade_requested)
+        {
+            upgrade_requested = 0;
+            stop_requested = terminate_requested;
+            raise(SIGUSR2);
+        }
+
+        // Рабочие процессы принимают соединения, мастер следит за ними и пишет снимки
+        handed_over = prefork_run(options.workers, worker_main, &ctx, options.snapshot_interval,
+                                  options.snapshot_interval > 0 ? snapshot_from_shared : NULL, hand_over) == 1;
+
+        // После передачи сокет и снимок принадлежат новому процессу
+        close(server_sock);
+        if (!handed_over)
+            unlink(socket_path);
+        if (options.snapshot_interval > 0 && !handed_over)
+            snapshot_from_shared(&ctx);
+        shared_cache_destroy();
+        domain_cache_destroy();
+    }
+    else
+    {
+        // Периодически сохраняем кэш, чтобы после перезапуска стартовать "теплыми"
+        if (options.snapshot_interval > 0)
+            domain_cache_start_snapshots(options.snapshot_path, options.snapshot_interval);
+
+        // Популярные домены обновляем в фоне до истечения TTL
+        domain_cache_start_refresher(options.refresh_window, options.refresh_min_hits, refresh_domain, &mmdb);
+
+        // SIGUSR2 передает сокет прямо из цикла, до дренажа открытых соединений
+        ServeContext ctx = {server_sock, &mmdb, &options};
+        serve(&ctx, 0, hand_over_before_drain);
+        handed_over = socket_handed_over;
+
+        // Закрываем серверный сокет (после передачи файл сокета уже слушает новый процесс)
+        close(server_sock);
+        if (!handed_over)
+            unlink(socket_path);
+
+        // Останавливаем фоновое обновление и сохраняем финальный снимок кэша
+        domain_cache_stop_refresher();
+        domain_cache_stop_snapshots(!handed_over);
+        domain_cache_destroy();
+    }
+
+    AdmissionStats stats;
+    admission_get_stats(&stats);
+    printf("Ограничение нагрузки: принято запросов: %lu, отказов (очередь заполнена): %lu, отказов (дедлайн): %lu, "
+           "отказов (скорость клиента): %lu\n",
+           stats.admitted, stats.shed_queue_full, stats.shed_deadline, stats.shed_rate_limit);
+    peer_limit_destroy();
+    admission_destroy();
+
+    precompressed_destroy();
+    flag_store_destroy();
 
     // Закрываем базу данных MMDB
     MMDB_close(&mmdb);
@@ -107,18 +505,248 @@ int main()
     return 0; // Завершаем программу
 }
 
+void serve_connections(const ServeContext *ctx, SocketStopFn on_stop)
+{
+    if (socket_serve(ctx->server_sock, &connection_limits, respond, (void *)ctx, &stop_requested, on_stop) < 0)
+        fprintf(stderr, "Не удалось запустить обслуживание соединений\n");
+}
+
+int parse_options(int argc, char *argv[], ServerOptions *options)
+{
+    static const struct option long_options[] = {
+        {"batch", required_argument, NULL, 'b'},
+        {"format", required_argument, NULL, 'f'},
+        {"threads", required_argument, NULL, 't'},
+        {"inflight", required_argument, NULL, 'i'},
+        {"cache-size", required_argument, NULL, 'c'},
+        {"snapshot", required_argument, NULL, 's'},
+        {"snapshot-interval", required_argument, NULL, 'S'},
+        {"refresh-window", required_argument, NULL, 'r'},
+        {"refresh-min-hits", required_argument, NULL, 'R'},
+        {"workers", required_argument, NULL, 'w'},
+        {"shared-cache-size", required_argument, NULL, 'W'},
+        {"io-backend", required_argument, NULL, 'I'},
+        {"flag-mode", required_argument, NULL, 'F'},
+        {"queue-depth", required_argument, NULL, 'q'},
+        {"deadline", required_argument, NULL, 'D'},
+        {"peer-limit", required_argument, NULL, 'P'},
+        {"header-timeout", required_argument, NULL, 'H'},
+        {"body-timeout", required_argument, NULL, 'B'},
+        {"write-timeout", required_argument, NULL, 'T'},
+        {"max-connections", required_argument, NULL, 'M'},
+        {"shards", required_argument, NULL, 'n'},
+        {"hot-cache-size", required_argument, NULL, 'K'},
+        {"server-timing", no_argument, NULL, 'G'},
+        {"help", no_argument, NULL, 'h'},
+        {NULL, 0, NULL, 0}};
+    int opt;
+
+    memset(options, 0, sizeof(*options));
+    options->batch_format = BATCH_FORMAT_CSV;
+    options->batch_threads = 8;
+    options->batch_inflight = 32;
+    options->cache_size = CACHE_DEFAULT_MAX_ENTRIES;
+    options->snapshot_path = DEFAULT_SNAPSHOT_PATH;
+    options->snapshot_interval = DEFAULT_SNAPSHOT_INTERVAL;
+    options->refresh_window = DEFAULT_REFRESH_WINDOW;
+    options->refresh_min_hits = DEFAULT_REFRESH_MIN_HITS;
+    options->workers = 1;
+    options->shared_cache_size = SHARED_CACHE_DEFAULT_ENTRIES;
+    options->io_backend = IO_BACKEND_SOCKETS;
+    options->flag_mode = FLAG_MODE_INLINE;
+    options->queue_depth = ADMISSION_DEFAULT_QUEUE_DEPTH;
+    options->deadline_ms = ADMISSION_DEFAULT_DEADLINE_MS;
+    options->header_timeout_ms = SOCKET_DEFAULT_HEADER_TIMEOUT_MS;
+    options->body_timeout_ms = SOCKET_DEFAULT_BODY_TIMEOUT_MS;
+    options->write_timeout_ms = SOCKET_DEFAULT_WRITE_TIMEOUT_MS;
+    options->max_connections = SOCKET_DEFAULT_MAX_CONNECTIONS;
+    options->hot_cache_size = HOT_CACHE_DEFAULT_ENTRIES;
+
+    while ((opt = getopt_long(argc, argv, "b:f:t:i:c:s:S:r:R:w:W:I:F:q:D:P:H:B:T:M:n:K:Gh", long_options, NULL)) != -1)
+    {
+        switch (opt)
+        {
+        case 'b':
+            options->batch_file = optarg;
+            break;
+        case 'f':
+            if (strcmp(optarg, "csv") == 0)
+                options->batch_format = BATCH_FORMAT_CSV;
+            else if (strcmp(optarg, "ndjson") == 0)
+                options->batch_format = BATCH_FORMAT_NDJSON;
+            else
+            {
+                fprintf(stderr, "Неизвестный формат вывода: %s (ожидается csv или ndjson)\n", optarg);
+                return -1;
+            }
+            break;
+        case 't':
+            options->batch_threads = atoi(optarg);
+            break;
+        case 'i':
+            options->batch_inflight = atoi(optarg);
+            break;
+        case 'c':
+            options->cache_size = atoi(optarg);
+            break;
+        case 's':
+            options->snapshot_path = optarg;
+            break;
+        case 'S':
+            options->snapshot_interval = atoi(optarg);
+            break;
+        case 'r':
+            options->refresh_window = atoi(optarg);
+            break;
+        case 'R':
+            options->refresh_min_hits = atoi(optarg);
+            break;
+        case 'w':
+            options->workers = atoi(optarg);
+            break;
+        case 'W':
+            options->shared_cache_size = atoi(optarg);
+            break;
+        case 'I':
+            if (strcmp(optarg, "sockets") == 0)
+                options->io_backend = IO_BACKEND_SOCKETS;
+            else if (strcmp(optarg, "uring") == 0)
+                options->io_backend = IO_BACKEND_URING;
+            else
+            {
+                fprintf(stderr, "Неизвестный механизм ввода-вывода: %s (ожидается sockets или uring)\n", optarg);
+                return -1;
+            }
+            break;
+        case 'F':
+            if (strcmp(optarg, "inline") == 0)
+                options->flag_mode = FLAG_MODE_INLINE;
+            else if (strcmp(optarg, "url") == 0)
+                options->flag_mode = FLAG_MODE_URL;
+            else
+            {
+                fprintf(stderr, "Неизвестный режим флагов: %s (ожидается inline или url)\n", optarg);
+                return -1;
+            }
+            break;
+        case 'q':
+            options->queue_depth = atoi(optarg);
+            break;
+        case 'D':
+            options->deadline_ms = atoi(optarg);
+            break;
+        case 'P':
+            if (options->peer_limit_count == PEER_LIMIT_MAX_RULES ||
+                peer_limit_parse(optarg, &options->peer_limits[options->peer_limit_count]) < 0)
+            {
+                fprintf(stderr, "Неверное правило --peer-limit: %s (ожидается UID|*:RATE[:BURST[:WEIGHT]])\n", optarg);
+                return -1;
+            }
+            options->peer_limit_count++;
+            break;
+        case 'H':
+            options->header_timeout_ms = atoi(optarg);
+            break;
+        case 'B':
+            options->body_timeout_ms = atoi(optarg);
+            break;
+        case 'T':
+            options->write_timeout_ms = atoi(optarg);
+            break;
+        case 'M':
+            options->max_connections = atoi(optarg);
+            break;
+        case 'n':
+            options->shards = strcmp(optarg, "auto") == 0 ? SHARDS_AUTO : atoi(optarg);
+            if (options->shards == 0 || options->shards < SHARDS_AUTO)
+            {
+                fprintf(stderr, "Неверное значение --shards: %s (ожидается N или auto)\n", optarg);
+                return -1;
+            }
+            break;
+        case 'K':
+            options->hot_cache_size = atoi(optarg);
+            break;
+        case 'G':
+            options->server_timing = 1;
+            break;
+        default:
+            fprintf(stderr,
+                    "Использование: %s [--batch FILE|-] [--format csv|ndjson] [--threads N] [--inflight N]\n"
+                    "       [--cache-size N] [--snapshot PATH] [--snapshot-interval SEC (0 - отключить)]\n"
+                    "       [--refresh-window SEC (0 - отключить)] [--refresh-min-hits N]\n"
+                    "       [--workers N] [--shared-cache-size N] [--io-backend sockets|uring]\n"
+                    "       [--flag-mode inline|url] [--queue-depth N] [--deadline MS (0 - отключить)]\n"
+                    "       [--peer-limit UID|*:RATE[:BURST[:WEIGHT]]]...\n"
+                    "       [--header-timeout MS] [--body-timeout MS] [--write-timeout MS] (0 - отключить)\n"
+                    "       [--max-connections N] [--shards N|auto] [--hot-cache-size N (0 - отключить)]\n"
+                    "       [--server-timing]\n",
+                    argv[0]);
+            return -1;
+        }
+    }
+
+    if (options->batch_threads < 1 || options->batch_inflight < 1 || options->cache_size < 1 ||
+        options->snapshot_interval < 0 || options->refresh_window < 0 || options->refresh_min_hits < 0 ||
+        options->workers < 1 || options->shared_cache_size < 1 || options->queue_depth < 1 || options->deadline_ms < 0 ||
+        options->header_timeout_ms < 0 || options->body_timeout_ms < 0 || options->write_timeout_ms < 0 ||
+        options->max_connections < 1 || options->hot_cache_size < 0)
+    {
+        fprintf(stderr, "Значения --threads, --inflight, --cache-size, --workers, --shared-cache-size, --queue-depth и --max-connections должны быть положительными\n");
+        return -1;
+    }
+
+    if (options->shards != 0 && options->workers > 1)
+    {
+        fprintf(stderr, "--shards задает количество рабочих процессов сам, --workers с ним не указывается\n");
+        return -1;
+    }
+
+    return 0;
+}
+
 void get_dns_info(const char *domain, char *ips, size_t ips_size)
+{
+    get_dns_info_ttl(domain, ips, ips_size, NULL);
+}
+
+void get_dns_info_ttl(const char *domain, char *ips, size_t ips_size, unsigned int *ttl)
 {
     FILE *fp;                 /**< Указатель на файл, который будет использоваться для выполнения команды `popen`. */
     char command[2048];       /**< Массив для хранения команды, которая будет выполнена с помощью popen. */
+    char server_arg[300];     /**< Аргументы `@host -p port` для `dig`, если задан DNS_SERVER. */
+    char timeout_arg[48];     /**< Ограничение ожидания `dig` по дедлайну запроса. */
+    char type[16];            /**< Тип записи из строки ответа `dig`. */
+    char address[64];         /**< Данные записи из строки ответа `dig`. */
+    unsigned int record_ttl;  /**< TTL записи из строки ответа `dig`. */
     char buffer[BUFFER_SIZE]; /**< Временный буфер для хранения строки, возвращенной командой `dig`. */
     struct in_addr ipv4_addr; /**< Структура для проверки корректности IP-адреса версии 4. */
 
+    PROBE1(dns__start, domain);
+
     // Выводим полученное имя домена для отладки
-    printf("Получена строка: %s\n", domain);
+    if (verbose)
+        printf("Получена строка: %s\n", domain);
 
-    // Формируем команду для получения DNS-информации
-    snprintf(command, sizeof(command), "dig +short %s", domain);
+    // Если задан DNS-сервер, направляем запрос на него
+    server_arg[0] = '\0';
+    if (dns_server != NULL && dns_server[0] != '\0')
+    {
+        const char *port = strrchr(dns_server, ':');
+        if (port != NULL)
+            snprintf(server_arg, sizeof(server_arg), "@%.*s -p %s ", (int)(port - dns_server), dns_server, port + 1);
+        else
+            snprintf(server_arg, sizeof(server_arg), "@%s ", dns_server);
+    }
+
+    // Дедлайн запроса ограничивает dig одной попыткой на оставшееся время (по умолчанию 3 попытки по 5 с)
+    timeout_arg[0] = '\0';
+    long remaining = admission_remaining_ms();
+    if (remaining >= 0)
+        snprintf(timeout_arg, sizeof(timeout_arg), "+time=%ld +tries=1 ", remaining > 1000 ? (remaining + 999) / 1000 : 1);
+
+    // Формируем команду для получения DNS-информации; +answer вместо +short, чтобы видеть TTL
+    snprintf(command, sizeof(command), "dig %s%s+noall +answer %s", server_arg, timeout_arg, domain);
 
     // Открываем процесс для выполнения команды
     fp = popen(command, "r");
@@ -126,167 +754,448 @@ void get_dns_info(const char *domain, char *ips, size_t ips_size)
     {
         // Если процесс не удалось открыть, выводим сообщение об ошибке и возвращаемся
         perror("popen");
+        PROBE2(dns__done, domain, "");
         return;
     }
 
     // Очищаем буфер для записи результирующей строки
     ips[0] = '\0';
+    if (ttl != NULL)
+        *ttl = 0;
 
-    // Читаем построчно результат команды dig
+    // Читаем построчно результат команды dig: "имя TTL класс тип данные"
     while (fgets(buffer, sizeof(buffer) - 1, fp) != NULL)
     {
-        // Убираем символ новой строки, если он есть
-        buffer[strcspn(buffer, "\n")] = '\0';
+        if (sscanf(buffer, "%*s %u %*s %15s %63s", &record_ttl, type, address) != 3 || strcmp(type, "A") != 0)
+            continue;
 
         // Проверяем, является ли строка корректным IPv4-адресом
-        if (inet_pton(AF_INET, buffer, &ipv4_addr) == 1)
+        if (inet_pton(AF_INET, address, &ipv4_addr) == 1)
         {
             // Если строка - это корректный IPv4-адрес, добавляем его в результирующую строку
-            strncat(ips, buffer, ips_size - strlen(ips) - 1);
+            strncat(ips, address, ips_size - strlen(ips) - 1);
             // Добавляем пробел между адресами
             strncat(ips, " ", ips_size - strlen(ips) - 1);
+
+            // Запоминаем минимальный TTL среди A-записей
+            if (ttl != NULL && (*ttl == 0 || record_ttl < *ttl))
+                *ttl = record_ttl;
         }
     }
 
     // Закрываем процесс
     pclose(fp);
+    PROBE2(dns__done, domain, ips);
+}
+
+char *stats_response(size_t *response_len)
+{
+    AdmissionStats stats;
+    struct json_object *json = json_object_new_object();
+
+    admission_get_stats(&stats);
+    json_object_object_add(json, "admitted", json_object_new_int64(stats.admitted));
+    json_object_object_add(json, "shedQueueFull", json_object_new_int64(stats.shed_queue_full));
+    json_object_object_add(json, "shedDeadline", json_object_new_int64(stats.shed_deadline));
+    json_object_object_add(json, "shedRateLimit", json_object_new_int64(stats.shed_rate_limit));
+    json_object_object_add(json, "queueDepth", json_object_new_int64(admission_queue_depth()));
+    json_object_object_add(json, "deadlineMs", json_object_new_int64(admission_deadline_ms()));
+
+    // Счетчики по uid клиентов, если включен --peer-limit
+    if (peer_limit_enabled())
+    {
+        PeerStats peers[PEER_LIMIT_MAX_PEERS];
+        size_t count = peer_limit_get_stats(peers);
+        struct json_object *list = json_object_new_array();
+
+        for (size_t i = 0; i < count; i++)
+        {
+            struct json_object *peer = json_object_new_object();
+            if (peers[i].uid == PEER_ANY_UID)
+                json_object_object_add(peer, "uid", json_object_new_string("*"));
+            else
+                json_object_object_add(peer, "uid", json_object_new_int64(peers[i].uid));
+            json_object_object_add(peer, "weight", json_object_new_int64(peers[i].weight));
+            json_object_object_add(peer, "rate", json_object_new_double(peers[i].rate));
+            json_object_object_add(peer, "admitted", json_object_new_int64(peers[i].admitted));
+            json_object_object_add(peer, "limited", json_object_new_int64(peers[i].limited));
+            json_object_array_add(list, peer);
+        }
+        json_object_object_add(json, "peers", list);
+    }
+
+    const char *body = json_object_to_json_string(json);
+    char headers[256];
+    int headers_len = snprintf(headers, sizeof(headers),
+                               "HTTP/1.1 200 OK\r\n"
+                               "Content-Type: application/json\r\n"
+                               "Content-Length: %zu\r\n"
+                               "Cache-Control: no-store\r\n"
+                               "Access-Control-Allow-Origin: *\r\n"
+                               "Connection: close\r\n"
+                               "\r\n",
+                               strlen(body));
+
+    char *response = malloc(headers_len + strlen(body));
+    if (response == NULL)
+    {
+        perror("malloc");
+        json_object_put(json);
+        return NULL;
+    }
+
+    memcpy(response, headers, headers_len);
+    memcpy(response + headers_len, body, strlen(body));
+    *response_len = headers_len + strlen(body);
+    json_object_put(json);
+    return response;
 }
 
-void handle_client(int client_sock, const MMDB_s *mmdb)
+/**
+ * @brief Ищет параметр в строке запроса.
+ *
+ * Имя совпадает только целиком: в начале строки или сразу после `&`, поэтому
+ * `noflag=url` не считается параметром `flag`.
+ *
+ * @param query Строка запроса после `?`.
+ * @param query_len Длина строки запроса.
+ * @param name Имя параметра вместе с `=`, например `"flag="`.
+ * @param value_len Длина значения (до `&` или конца строки запроса).
+ * @return Указатель на значение или NULL, если параметра нет.
+ */
+static const char *query_param(const char *query, size_t query_len, const char *name, size_t *value_len)
+{
+    size_t name_len = strlen(name);
+    const char *end = query + query_len;
+
+    for (const char *param = query; param < end;)
+    {
+        size_t param_len = strcspn(param, "&");
+        if (param + param_len > end)
+            param_len = end - param;
+
+        if (param_len >= name_len && strncmp(param, name, name_len) == 0)
+        {
+            *value_len = param_len - name_len;
+            return param + name_len;
+        }
+        param += param_len + 1;
+    }
+    return NULL;
+}
+
+/**
+ * @brief Находит путь в строке запроса.
+ *
+ * Путь идет после метода до пробела, `?` или конца строки. Запрос может
+ * состоять из одного пути (так шлет bench-client). Маршрут выбирается только по
+ * пути: те же подстроки в заголовках (например, в `Referer`) не учитываются.
+ *
+ * @param request Полный текст запроса, завершенный нулем.
+ * @param path_len Длина пути без строки запроса.
+ * @return Указатель на начало пути внутри `request`.
+ */
+static const char *request_path(const char *request, size_t *path_len)
+{
+    const char *path = request;
+
+    if (*path != '/')
+    {
+        size_t method_len = strcspn(request, " \r\n");
+        path = request + method_len + (request[method_len] == ' ');
+    }
+    *path_len = strcspn(path, " ?\r\n");
+    return path;
+}
+
+/**
+ * @brief Начинается ли путь с префикса маршрута.
+ */
+static int path_has_prefix(const char *path, size_t path_len, const char *prefix)
+{
+    size_t prefix_len = strlen(prefix);
+    return path_len >= prefix_len && strncmp(path, prefix, prefix_len) == 0;
+}
+
+char *build_response(const char *request, const MMDB_s *mmdb, size_t *response_len)
 {
     // Буферы для хранения данных
-    char buffer[BUFFER_SIZE];        // Буфер для приема данных от клиента
     char ips[BUFFER_SIZE];           // Буфер для хранения IP-адресов
-    char first_ip[BUFFER_SIZE];      // Буфер для хранения первого IP-адреса
     char country_code[BUFFER_SIZE];  // Буфер для хранения кода страны
-    char json_response[BUFFER_SIZE]; // Буфер для хранения JSON-ответа
+    char json_prefix[BUFFER_SIZE + GEO_FIELDS_FRAGMENT_MAX]; // Буфер для динамической части JSON-ответа
+
+    if (verbose)
+        printf("Запрос из браузера: %s\n", request);
 
-    // Получаем данные от клиента
-    int recv_len = recv(client_sock, buffer, sizeof(buffer) - 1, 0);
-    if (recv_len < 0)
+    // Маршрут определяем по пути из строки запроса
+    size_t path_len;
+    const char *path = request_path(request, &path_len);
+    if (!path_has_prefix(path, path_len, "/what-is-country/"))
     {
-        perror("recv"); // Печатаем сообщение об ошибке, если прием данных не удался
-        return;         // Выходим из функции
-    }
-    buffer[recv_len] = '\0'; // Завершаем строку нулевым символом
+        // Изображение флага: /flag/<ISO>.png
+        if (path_has_prefix(path, path_len, FLAG_URL_PREFIX))
+            return flag_store_response(request, path, response_len);
 
-    printf("Запрос из браузера: %s\n", buffer);
+        // Счетчики ограничения нагрузки: ровно /stats (строка запроса допускается)
+        if (path_len == strlen(STATS_PATH) && strncmp(path, STATS_PATH, path_len) == 0)
+            return stats_response(response_len);
 
-    // Извлекаем домен из строки запроса
-    char *domain_start = strstr(buffer, "/what-is-country/");
-    if (domain_start != NULL)
-    {
-        domain_start += strlen("/what-is-country/"); // Сдвигаем указатель на начало домена
+        fprintf(stderr, "Invalid request format.\n");
+        *response_len = strlen("Invalid request format.\n");
+        return strdup("Invalid request format.\n");
+    }
 
-        // Копируем домен в буфер
-        char domain[BUFFER_SIZE];
-        strncpy(domain, domain_start, sizeof(domain) - 1);
-        domain[sizeof(domain) - 1] = '\0'; // Завершаем строку нулевым символом
+    const char *domain_start = path + strlen("/what-is-country/"); // Начало домена
 
-        // Убираем возможные символы новой строки
-        char *newline_pos = strchr(domain, '\n');
-        if (newline_pos != NULL)
-            *newline_pos = '\0';
+    // Домен идет до конца пути: пробела перед версией HTTP, строки запроса или перевода строки.
+    // В буфер попадает только каноническая форма, а некорректное имя отвергаем до кэша и DNS
+    char domain[DOMAIN_NAME_MAX + 1];
+    size_t domain_len = path + path_len - domain_start;
+    if (domain_canonicalize(domain_start, domain_len, domain) < 0)
+    {
+        *response_len = sizeof(RESPONSE_BAD_DOMAIN) - 1;
+        return strdup(RESPONSE_BAD_DOMAIN);
+    }
 
-        // Получаем информацию о DNS (в данном случае IP-адреса)
-        get_dns_info(domain, ips, sizeof(ips));
+    // Параметр ?flag=url|inline переопределяет режим выдачи флага для этого запроса,
+    // а ?fields=city,location,... добавляет в ответ поля записи MMDB
+    FlagMode mode = flag_mode;
+    unsigned int fields = 0;
+    if (domain_start[domain_len] == '?')
+    {
+        const char *query = domain_start + domain_len + 1;
+        size_t query_len = strcspn(query, " \r\n");
+        size_t value_len;
+        const char *param = query_param(query, query_len, "flag=", &value_len);
+        if (param != NULL)
+        {
+            if (value_len == 3 && strncmp(param, "url", 3) == 0)
+                mode = FLAG_MODE_URL;
+            else if (value_len == 6 && strncmp(param, "inline", 6) == 0)
+                mode = FLAG_MODE_INLINE;
+        }
 
-        // Извлекаем первый IP-адрес из строки IP-адресов
-        char *first_ip_end = strchr(ips, ' '); // Ищем первый пробел в строке IP-адресов
-        if (first_ip_end != NULL)
+        param = query_param(query, query_len, "fields=", &value_len);
+        if (param != NULL)
         {
-            size_t len = first_ip_end - ips; // Определяем длину первого IP-адреса
-            if (len >= sizeof(first_ip))
+            if (geo_fields_parse(param, value_len, &fields) < 0)
             {
-                len = sizeof(first_ip) - 1; // Ограничиваем длину, если она больше размера буфера
+                *response_len = sizeof(RESPONSE_BAD_FIELDS) - 1;
+                return strdup(RESPONSE_BAD_FIELDS);
             }
-            strncpy(first_ip, ips, len); // Копируем первый IP-адрес в буфер
-            first_ip[len] = '\0';        // Завершаем строку нулевым символом
-        }
-        else
-        {
-            snprintf(first_ip, sizeof(first_ip), "%s", ips); // Если пробел не найден, копируем всю строку
         }
+    }
 
-        // Получаем информацию о стране и флаге для первого IP-адреса
-        const Flag *flag_struct = get_geo_info(mmdb, first_ip, country_code, sizeof(country_code));
+    // Клиент ждал в очереди дольше дедлайна - быстро отказываем, не тратя время на DNS
+    if (admission_expired())
+        return admission_shed_response(SHED_DEADLINE, response_len);
 
-        // Создаем новый JSON-объект
-        struct json_object *json_obj = json_object_new_object();
-        struct json_object *json_ips = json_object_new_string(ips); // Создаем JSON-строку для IP-адресов
-        json_object_object_add(json_obj, "ips", json_ips);          // Добавляем IP-адреса в JSON
+    // С --server-timing стадии запроса замеряются для заголовка Server-Timing
+    trace_begin();
 
-        // Если получена информация о флаге, добавляем её в JSON
-        if (flag_struct)
+    // Получаем IP-адреса и информацию о стране и флаге (из кэша или через DNS и MMDB)
+    uint64_t started = trace_now();
+    const Flag *flag_struct = lookup_domain(mmdb, domain, ips, sizeof(ips), country_code, sizeof(country_code));
+    trace_add(TRACE_LOOKUP, started);
+
+    // Дедлайн истек во время DNS или геопоиска: результат уже в кэше, но клиенту отвечаем 503
+    if (admission_expired())
+        return admission_shed_response(SHED_DEADLINE, response_len);
+
+    // Динамическая часть ответа - только IP-адреса, остальное берем готовым для страны
+    struct json_object *json_ips = json_object_new_string(ips); // Создаем JSON-строку для IP-адресов
+    int prefix_len = snprintf(json_prefix, sizeof(json_prefix), "{\"ips\": %s", json_object_to_json_string(json_ips));
+    json_object_put(json_ips);
+    if (prefix_len < 0 || (size_t)prefix_len >= sizeof(json_prefix))
+        prefix_len = 0;
+
+    // Запрошенные поля геобазы для первого IP-адреса (фрагмент кэшируется по сети базы)
+    if (fields != 0 && prefix_len > 0)
+    {
+        char first_ip[INET_ADDRSTRLEN];
+        extract_first_ip(ips, first_ip, sizeof(first_ip));
+        started = trace_now();
+        int fields_len = geo_fields_format(mmdb, first_ip, fields, json_prefix + prefix_len,
+                                           sizeof(json_prefix) - prefix_len);
+        trace_add(TRACE_FIELDS, started);
+        if (fields_len < 0)
         {
-            json_object_object_add(json_obj, "flagImg", json_object_new_string(flag_struct->flag_img)); // Добавляем изображение флага
-            json_object_object_add(json_obj, "countryName", json_object_new_string(flag_struct->name)); // Добавляем название страны
+            // Не отвечаем 200 без запрошенных полей: клиент должен видеть, что их нет
+            fprintf(stderr, "Поля геобазы не поместились в ответ\n");
+            return NULL;
         }
+        prefix_len += fields_len;
+    }
 
-        // Преобразуем JSON-объект в строку и сохраняем её в буфере ответа
-        snprintf(json_response, sizeof(json_response), "%s", json_object_to_json_string(json_obj));
+    // Флаг и название страны: заранее подготовленный (и сжатый) фрагмент
+    const ResponseFragment *fragment = precompressed_fragment(flag_struct, mode);
+    ContentEncoding encoding = precompressed_negotiate(request, fragment);
+    size_t body_len;
+    started = trace_now();
+    char *body = precompressed_body(json_prefix, prefix_len, fragment, encoding, &body_len);
+    if (body == NULL)
+    {
+        fprintf(stderr, "Не удалось сформировать тело ответа\n");
+        return NULL;
+    }
+    trace_add(TRACE_BODY, started);
 
-        size_t response_size = snprintf(NULL, 0,
-                                        "HTTP/1.1 200 OK\r\n"
-                                        "Content-Type: application/json\r\n"
-                                        "Content-Length: %ld\r\n"
-                                        "Access-Control-Allow-Origin: *\r\n" // Добавляем заголовок CORS
-                                        "Connection: close\r\n"
-                                        "\r\n%s",
-                                        strlen(json_response), json_response);
+    char timing[256];
+    timing[0] = '\0';
+    trace_header(timing, sizeof(timing));
 
-        char *response = malloc(response_size + 1); // +1 для нулевого байта
+    char headers[512];
+    int headers_len = snprintf(headers, sizeof(headers),
+                               "HTTP/1.1 200 OK\r\n"
+                               "Content-Type: application/json\r\n"
+                               "Content-Length: %zu\r\n"
+                               "%s"
+                               "%s"
+                               "Vary: Accept-Encoding\r\n"
+                               "Access-Control-Allow-Origin: *\r\n" // Добавляем заголовок CORS
+                               "Connection: close\r\n"
+                               "\r\n",
+                               body_len, encoding == ENCODING_GZIP ? "Content-Encoding: gzip\r\n" : "", timing);
 
-        if (response == NULL)
-        {
-            perror("malloc");
-            return;
-        }
+    char *response = malloc(headers_len + body_len);
 
-        snprintf(response, response_size + 1,
-                 "HTTP/1.1 200 OK\r\n"
-                 "Content-Type: application/json\r\n"
-                 "Content-Length: %ld\r\n"
-                 "Access-Control-Allow-Origin: *\r\n" // Добавляем заголовок CORS
-                 "Connection: close\r\n"
-                 "\r\n%s",
-                 strlen(json_response), json_response);
+    if (response == NULL)
+    {
+        perror("malloc");
+        free(body);
+        return NULL;
+    }
 
-        // Отправляем ответ
-        send(client_sock, response, response_size, 0);
+    memcpy(response, headers, headers_len);
+    memcpy(response + headers_len, body, body_len);
+    free(body);
 
-        // Освобождаем память
-        free(response);
+    size_t response_size = headers_len + body_len;
+    *response_len = response_size;
+    return response;
+}
+
+const Flag *lookup_domain(const MMDB_s *mmdb, const char *domain, char *ips, size_t ips_size,
+                         char *country_code, size_t country_code_size)
+{
+    DomainCacheRecord record;
 
-        // Освобождаем ресурсы, связанные с JSON-объектом
-        json_object_put(json_obj);
+    // Горячий кэш потока (только в режиме --shards) не берет блокировок
+    if (hot_cache_get(domain, &record))
+    {
+        domain_cache_format_ips(&record, ips, ips_size);
+        snprintf(country_code, country_code_size, "%s", record.country_code);
+        return country_code[0] != '\0' ? find_flag(country_code) : NULL;
     }
-    else
+
+    // Затем в кэш доменов (попадание может запустить фоновое обновление записи)
+    if (domain_cache_get(domain, &record))
     {
-        send(client_sock, "Invalid request format.\n", strlen("Invalid request format.\n"), 0);
-        fprintf(stderr, "Invalid request format.\n");
+        hot_cache_put(&record);
+        domain_cache_format_ips(&record, ips, ips_size);
+        snprintf(country_code, country_code_size, "%s", record.country_code);
+        return country_code[0] != '\0' ? find_flag(country_code) : NULL;
+    }
+
+    // Затем в общий кэш рабочих процессов: результат другого процесса переносим в свой кэш.
+    // Шарды его не читают, чтобы попадания не трогали общую память
+    if (!sharded && shared_cache_get(domain, &record))
+    {
+        domain_cache_put_record(&record);
+        domain_cache_format_ips(&record, ips, ips_size);
+        snprintf(country_code, country_code_size, "%s", record.country_code);
+        return country_code[0] != '\0' ? find_flag(country_code) : NULL;
     }
+
+    return resolve_domain(mmdb, domain, ips, ips_size, country_code, country_code_size);
 }
 
-const Flag *get_geo_info(const MMDB_s *mmdb, const char *ip, char *country_code, size_t country_code_size)
+const Flag *resolve_domain(const MMDB_s *mmdb, const char *domain, char *ips, size_t ips_size,
+                           char *country_code, size_t country_code_size)
 {
-    // Получаем страну по IP-адресу
-    country_code = get_country_from_ip(ip, *mmdb);
+    char first_ip[INET_ADDRSTRLEN];
+    unsigned int ttl = 0;
+
+    // Получаем информацию о DNS (в данном случае IP-адреса)
+    ips[0] = '\0';
+    uint64_t started = trace_now();
+    get_dns_info_ttl(domain, ips, ips_size, &ttl);
+    trace_add(TRACE_DNS, started);
+
+    // Извлекаем первый IP-адрес из строки IP-адресов
+    extract_first_ip(ips, first_ip, sizeof(first_ip));
 
-    if(country_code != NULL){
-        // Найти флаг по коду страны
-        for (size_t i = 0; i < FLAGS_COUNT; ++i)
+    // Получаем информацию о стране и флаге для первого IP-адреса
+    started = trace_now();
+    const Flag *flag = get_geo_info(mmdb, first_ip, country_code, country_code_size);
+    trace_add(TRACE_GEO, started);
+
+    // Кэшируем только успешные разрешения, на время их TTL
+    DomainCacheRecord record;
+    if (ips[0] != '\0' && ttl > 0 && domain_cache_make_record(domain, ips, country_code, ttl, &record) == 0)
+    {
+        domain_cache_put_record(&record);
+        shared_cache_put(&record);
+    }
+
+    return flag;
+}
+
+void refresh_domain(const char *domain, void *arg)
+{
+    char ips[BUFFER_SIZE];
+    char country_code[16];
+
+    resolve_domain((const MMDB_s *)arg, domain, ips, sizeof(ips), country_code, sizeof(country_code));
+}
+
+void extract_first_ip(const char *ips, char *first_ip, size_t first_ip_size)
+{
+    size_t len = strcspn(ips, " "); // Длина до первого пробела или до конца строки
+
+    if (len >= first_ip_size)
+    {
+        len = first_ip_size - 1; // Ограничиваем длину, если она больше размера буфера
+    }
+    memcpy(first_ip, ips, len); // Копируем первый IP-адрес в буфер
+    first_ip[len] = '\0';       // Завершаем строку нулевым символом
+}
+
+const Flag *find_flag(const char *country_code)
+{
+    // Найти флаг по коду страны
+    for (size_t i = 0; i < FLAGS_COUNT; ++i)
+    {
+        if (strcmp(flags[i].key, country_code) == 0)
         {
-            if (strcmp(flags[i].key, country_code) == 0)
-            {
-                return &flags[i];
-            }
+            return &flags[i];
         }
-    }   
+    }
 
     return NULL;
 }
 
+const Flag *get_geo_info(const MMDB_s *mmdb, const char *ip, char *country_code, size_t country_code_size)
+{
+    const Flag *flag = NULL;
+
+    PROBE1(geo__start, ip);
+
+    // Получаем страну по IP-адресу
+    char *code = get_country_from_ip(ip, *mmdb);
+
+    country_code[0] = '\0';
+    if (code != NULL)
+    {
+        snprintf(country_code, country_code_size, "%s", code);
+        flag = find_flag(code);
+        free(code);
+    }
+
+    PROBE2(geo__done, ip, country_code);
+    return flag;
+}
+
 int is_valid_ipv4(const char *ip)
 {
     struct sockaddr_in sa; /**< Структура для хранения результата преобразования строки в IPv4. */
@@ -297,4 +1206,4 @@ int is_valid_ipv4(const char *ip)
     return inet_pton(AF_INET, ip, &(sa.sin_addr)) != 0;
 }
 
-// gcc -o unix-server unix-server.c geo_lookup.c -lmaxminddb -ljson-c
\ No newline at end of file
+// gcc -o unix-server unix-server.c geo_lookup.c batch.c domain_cache.c shared_cache.c prefork.c uring_server.c flag_store.c precompressed.c upgrade.c admission.c peer_limit.c socket_server.c timer_wheel.c shard.c hot_cache.c domain_name.c geo_fields.c trace.c -lmaxminddb -ljson-c -lz -lpthread
\ No newline at end of file
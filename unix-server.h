@@ -2,16 +2,108 @@
 #define UNIX_SERVER_H
 
 #include <maxminddb.h> // For MaxMindDB database
-#include "flags.h"     // For Flag structure
+#include "flag_type.h" // For Flag structure
+#include "batch.h"     // For BatchFormat
+#include "flag_store.h" // For FlagMode
+#include "peer_limit.h" // For PeerLimitRule
+#include "socket_server.h" // For SocketStopFn
 
 #define SOCKET_PATH "/tmp/myserver.sock"
 #define BUFFER_SIZE 1024
+#define DEFAULT_DB_PATH "./GeoLite2-City.mmdb"
+#define STATS_PATH "/stats"
+
+/**
+ * @brief Механизм ввода-вывода для обслуживания соединений.
+ */
+typedef enum
+{
+    IO_BACKEND_SOCKETS, /**< Блокирующие accept/recv/send/close. */
+    IO_BACKEND_URING    /**< io_uring (с откатом на сокеты, если недоступен). */
+} IoBackend;
+
+/**
+ * @brief Параметры запуска, полученные из командной строки.
+ */
+typedef struct
+{
+    const char *batch_file;   /**< Файл доменов для пакетного режима ("-" - stdin, NULL - режим сервера). */
+    BatchFormat batch_format; /**< Формат вывода пакетного режима. */
+    int batch_threads;        /**< Количество рабочих потоков пакетного режима. */
+    int batch_inflight;       /**< Максимум одновременных DNS-запросов в пакетном режиме. */
+    int cache_size;           /**< Емкость кэша доменов. */
+    const char *snapshot_path; /**< Файл снимка кэша. */
+    int snapshot_interval;    /**< Период записи снимка в секундах (0 - снимки отключены). */
+    int refresh_window;       /**< За сколько секунд до истечения обновлять популярные записи (0 - выключено). */
+    int refresh_min_hits;     /**< Сколько обращений делает запись популярной. */
+    int workers;              /**< Количество рабочих процессов (1 - без prefork). */
+    int shared_cache_size;    /**< Емкость общего кэша рабочих процессов. */
+    IoBackend io_backend;     /**< Механизм ввода-вывода. */
+    FlagMode flag_mode;       /**< Режим выдачи флага по умолчанию. */
+    int queue_depth;          /**< Глубина очереди ожидающих запросов на процесс. */
+    int deadline_ms;          /**< Дедлайн запроса от accept в миллисекундах (0 - без дедлайна). */
+    PeerLimitRule peer_limits[PEER_LIMIT_MAX_RULES]; /**< Правила `--peer-limit` по uid клиентов. */
+    int peer_limit_count;     /**< Количество правил (0 - ограничение по клиентам выключено). */
+    int header_timeout_ms;    /**< Сколько ждать заголовков запроса, мс (0 - без таймаута). */
+    int body_timeout_ms;      /**< Сколько ждать тела запроса, мс (0 - без таймаута). */
+    int write_timeout_ms;     /**< Сколько ждать отправки ответа, мс (0 - без таймаута). */
+    int max_connections;      /**< Предел открытых соединений на процесс. */
+    int shards;               /**< Шардов по ядрам (0 - выключено, SHARDS_AUTO - по числу ядер). */
+    int hot_cache_size;       /**< Слотов горячего кэша на поток в режиме шардов (0 - без него). */
+    int server_timing;        /**< Добавлять ли к ответам заголовок Server-Timing со стадиями запроса. */
+} ServerOptions;
+
+/**
+ * @brief Контекст, передаваемый циклам обслуживания, рабочим процессам и задаче обслуживания мастера.
+ */
+typedef struct
+{
+    int server_sock;              /**< Слушающий сокет. */
+    const MMDB_s *mmdb;           /**< Открытая база MaxMind. */
+    const ServerOptions *options; /**< Параметры запуска. */
+} ServeContext;
+
+/**
+ * @brief Разбирает аргументы командной строки.
+ *
+ * Поддерживаются `--batch FILE`, `--format csv|ndjson`, `--threads N`, `--inflight N`,
+ * `--cache-size N`, `--snapshot PATH`, `--snapshot-interval SEC`, `--refresh-window SEC`
+ * `--refresh-min-hits N`, `--workers N`, `--shared-cache-size N`, `--io-backend sockets|uring`,
+ * `--flag-mode inline|url`, `--queue-depth N`, `--deadline MS`, `--peer-limit UID|*:RATE[:BURST[:WEIGHT]]`
+ * (можно повторять), `--header-timeout MS`, `--body-timeout MS`, `--write-timeout MS`,
+ * `--max-connections N`, `--shards N|auto`, `--hot-cache-size N` и `--server-timing`.
+ * Незаданные параметры получают значения по умолчанию.
+ *
+ * @param argc Количество аргументов.
+ * @param argv Массив аргументов.
+ * @param options Структура для записи результата.
+ * @return 0 при успехе, -1 при ошибке (сообщение уже напечатано).
+ */
+int parse_options(int argc, char *argv[], ServerOptions *options);
+
+/**
+ * @brief Принимает и обрабатывает соединения, пока не получен SIGINT/SIGTERM.
+ *
+ * Режим обычных сокетов: неблокирующий цикл epoll из `socket_serve` с таймаутами
+ * медленных клиентов и пределом соединений из `--header-timeout`, `--body-timeout`,
+ * `--write-timeout` и `--max-connections`. Ответы формирует `build_response`.
+ * При остановке дообслуживает открытые соединения и печатает количество запросов,
+ * системных вызовов и закрытых по таймауту соединений.
+ *
+ * @param ctx Слушающий сокет, база MaxMind и параметры запуска.
+ * @param on_stop Функция, вызываемая при остановке до дренажа (например, передача сокета), или NULL.
+ */
+void serve_connections(const ServeContext *ctx, SocketStopFn on_stop);
 
 /**
  * @brief Получает информацию о DNS для заданного домена и возвращает только IPv4-адреса.
  *
- * Функция выполняет команду `dig +short` для получения информации о DNS и объединяет
+ * Функция выполняет команду `dig +noall +answer` для получения информации о DNS и объединяет
  * только корректные IPv4-адреса в одну строку. Данные, не являющиеся IPv4-адресами, исключаются.
+ * Если задана переменная окружения `DNS_SERVER` (`host` или `host:port`), запрос
+ * отправляется на указанный сервер, например на заглушку `tools/dns-stub`.
+ * Если поток обслуживает запрос с дедлайном, `dig` делает одну попытку с таймаутом
+ * на оставшееся время.
  *
  * @param domain Строка с именем домена.
  * @param ips Буфер для записи результирующей строки с IP-адресами.
@@ -20,15 +112,77 @@
 void get_dns_info(const char *domain, char *ips, size_t ips_size);
 
 /**
- * Обрабатывает соединение с клиентом.
+ * @brief То же, что `get_dns_info`, но дополнительно возвращает TTL ответа.
  *
- * Эта функция получает запрос от клиента, извлекает домен из запроса,
- * получает IP-адреса для домена, находит информацию о стране и возвращает её в формате JSON.
+ * @param domain Строка с именем домена.
+ * @param ips Буфер для записи результирующей строки с IP-адресами.
+ * @param ips_size Размер буфера для IP-адресов.
+ * @param ttl Минимальный TTL среди A-записей (0, если адресов нет). Может быть NULL.
+ */
+void get_dns_info_ttl(const char *domain, char *ips, size_t ips_size, unsigned int *ttl);
+
+/**
+ * @brief Возвращает IP-адреса и страну домена, используя кэш доменов.
  *
- * @param client_sock Дескриптор сокета клиента.
- * @param mmdb Указатель на структуру базы данных MaxMind, предварительно открытая.
+ * Порядок поиска: горячий кэш потока (в режиме `--shards`), локальный кэш процесса,
+ * общий кэш рабочих процессов (в режиме `--workers`), затем `resolve_domain`.
+ *
+ * @param mmdb Указатель на открытую базу MaxMind.
+ * @param domain Имя домена.
+ * @param ips Буфер для IP-адресов через пробел.
+ * @param ips_size Размер буфера `ips`.
+ * @param country_code Буфер для кода страны.
+ * @param country_code_size Размер буфера `country_code`.
+ * @return Указатель на структуру `Flag` или NULL, если страна не определена.
+ */
+const Flag *lookup_domain(const MMDB_s *mmdb, const char *domain, char *ips, size_t ips_size,
+                         char *country_code, size_t country_code_size);
+
+/**
+ * @brief Разрешает домен через `get_dns_info_ttl` и `get_geo_info`, минуя кэш.
+ *
+ * Успешный результат сохраняется в локальный и общий кэш на время TTL.
+ * Параметры и результат такие же, как у `lookup_domain`.
+ */
+const Flag *resolve_domain(const MMDB_s *mmdb, const char *domain, char *ips, size_t ips_size,
+                           char *country_code, size_t country_code_size);
+
+/**
+ * @brief Callback фонового обновления кэша: заново разрешает домен.
+ *
+ * @param domain Имя домена.
+ * @param arg Указатель на открытую базу MaxMind (`const MMDB_s *`).
+ */
+void refresh_domain(const char *domain, void *arg);
+
+/**
+ * @brief Формирует HTTP-ответ на запрос клиента.
+ *
+ * Не выполняет ввода-вывода с сокетом клиента, поэтому используется и циклом
+ * epoll (`socket_serve`), и циклом io_uring. Запросы `/flag/<ISO>.png` обслуживаются из
+ * декодированных при запуске изображений. Параметр `?flag=url|inline` запроса
+ * `/what-is-country/<домен>` выбирает, отдавать ли флаг ссылкой или в base64.
+ * Параметр `?fields=city,location,...` добавляет поля записи MMDB (см. `geo_fields_format`),
+ * на неизвестное поле возвращается 400.
+ * Домен приводится к канонической форме (`domain_canonicalize`), а на некорректное
+ * имя сразу возвращается 400 без обращения к кэшу и DNS. Если дедлайн запроса (см. `admission_begin`) истек до или во время поиска домена,
+ * возвращается 503 с `Retry-After`. `/stats` отдает счетчики ограничения нагрузки.
+ * С `--server-timing` успешный ответ содержит заголовок `Server-Timing` (см. `trace_header`).
+ *
+ * @param request Текст запроса, завершенный нулем.
+ * @param mmdb Указатель на открытую базу MaxMind.
+ * @param response_len Длина ответа.
+ * @return Ответ, выделенный через malloc (освобождает вызывающий), или NULL при ошибке.
  */
-void handle_client(int client_sock, const MMDB_s *mmdb);
+char *build_response(const char *request, const MMDB_s *mmdb, size_t *response_len);
+
+/**
+ * @brief Формирует JSON-ответ со счетчиками ограничения нагрузки для `/stats`.
+ *
+ * @param response_len Длина ответа.
+ * @return Ответ, выделенный через malloc, или NULL при ошибке.
+ */
+char *stats_response(size_t *response_len);
 
 /**
  * @brief Получает информацию о стране и флаге по IP-адресу.
@@ -45,6 +199,23 @@ void handle_client(int client_sock, const MMDB_s *mmdb);
  */
 const Flag *get_geo_info(const MMDB_s *mmdb, const char *ip, char *country_code, size_t country_code_size);
 
+/**
+ * @brief Копирует первый адрес из списка IP-адресов, разделенных пробелами.
+ *
+ * @param ips Строка с IP-адресами, как ее возвращает `get_dns_info`.
+ * @param first_ip Буфер для первого адреса.
+ * @param first_ip_size Размер буфера `first_ip`.
+ */
+void extract_first_ip(const char *ips, char *first_ip, size_t first_ip_size);
+
+/**
+ * @brief Ищет флаг по двухбуквенному коду страны.
+ *
+ * @param country_code Код страны ISO 3166-1 alpha-2.
+ * @return Указатель на элемент таблицы флагов или NULL, если код неизвестен.
+ */
+const Flag *find_flag(const char *country_code);
+
 /**
  * @brief Проверяет, является ли строка валидным IPv4-адресом.
  *
@@ -0,0 +1,218 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <limits.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+#include "upgrade.h"
+
+#define UPGRADE_READY_BYTE 'R'
+
+static char exe_path[PATH_MAX];
+static char **saved_argv = NULL;
+static int ready_channel = -1;
+
+void upgrade_init(char *argv[])
+{
+    ssize_t len = readlink("/proc/self/exe", exe_path, sizeof(exe_path) - 1);
+
+    // Без /proc запускаем по argv[0], как его передал предыдущий запуск
+    if (len > 0)
+        exe_path[len] = '\0';
+    else
+        snprintf(exe_path, sizeof(exe_path), "%s", argv[0]);
+    saved_argv = argv;
+}
+
+/**
+ * @brief Отправляет дескрипторы по Unix-сокету (SCM_RIGHTS) вместе с одним байтом данных.
+ */
+static int send_fds(int channel, const int *fds, int count)
+{
+    char byte = 0;
+    struct iovec iov = {&byte, 1};
+    union
+    {
+        struct cmsghdr align;
+        char buf[CMSG_SPACE(2 * sizeof(int))];
+    } control;
+    struct msghdr msg;
+
+    memset(&msg, 0, sizeof(msg));
+    memset(&control, 0, sizeof(control));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control.buf;
+    msg.msg_controllen = CMSG_SPACE(count * sizeof(int));
+
+    struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(count * sizeof(int));
+    memcpy(CMSG_DATA(cmsg), fds, count * sizeof(int));
+
+    return sendmsg(channel, &msg, MSG_NOSIGNAL) == 1 ? 0 : -1;
+}
+
+int upgrade_spawn(int listen_fd, UpgradeStateFn write_state, void *arg)
+{
+    int channel[2];
+    int fds[2] = {listen_fd, -1};
+    int count = 1;
+
+    if (saved_argv == NULL)
+        return -1;
+
+    if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, channel) < 0)
+    {
+        perror("socketpair");
+        return -1;
+    }
+
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid < 0)
+    {
+        perror("fork");
+        close(channel[0]);
+        close(channel[1]);
+        return -1;
+    }
+
+    if (pid == 0)
+    {
+        char value[16];
+        sigset_t empty;
+
+        // Новый процесс получит сокет через канал, унаследованная копия ему не нужна
+        fcntl(listen_fd, F_SETFD, FD_CLOEXEC);
+        fcntl(channel[1], F_SETFD, 0);
+        snprintf(value, sizeof(value), "%d", channel[1]);
+        setenv(UPGRADE_FD_ENV, value, 1);
+
+        // Маска сигналов наследуется через exec, а мастер prefork держит сигналы заблокированными
+        sigemptyset(&empty);
+        sigprocmask(SIG_SETMASK, &empty, NULL);
+
+        execv(exe_path, saved_argv);
+        perror("execv");
+        _exit(127);
+    }
+
+    close(channel[1]);
+    printf("Обновление: запущен новый процесс %s (pid %d)\n", exe_path, (int)pid);
+    fflush(stdout);
+
+    // Теплое состояние передаем через анонимный файл в памяти
+    if (write_state != NULL)
+    {
+        int state_fd = memfd_create("unix-server-state", MFD_CLOEXEC);
+        if (state_fd >= 0 && write_state(state_fd, arg) >= 0)
+            fds[count++] = state_fd;
+        else if (state_fd >= 0)
+            close(state_fd);
+    }
+
+    int status = send_fds(channel[0], fds, count);
+    if (count > 1)
+        close(fds[1]);
+
+    // Ждем байт готовности: EOF означает, что новый процесс завершился
+    if (status == 0)
+    {
+        struct pollfd pfd = {channel[0], POLLIN, 0};
+        char byte = 0;
+
+        status = -1;
+        if (poll(&pfd, 1, UPGRADE_READY_TIMEOUT * 1000) == 1 && read(channel[0], &byte, 1) == 1 &&
+            byte == UPGRADE_READY_BYTE)
+            status = 0;
+    }
+    close(channel[0]);
+
+    if (status < 0)
+    {
+        fprintf(stderr, "Обновление: новый процесс не подтвердил готовность, продолжаем работу\n");
+        kill(pid, SIGTERM);
+        waitpid(pid, NULL, 0);
+        return -1;
+    }
+
+    printf("Обновление: сокет передан процессу %d\n", (int)pid);
+    fflush(stdout);
+    return 0;
+}
+
+int upgrade_receive(int *listen_fd, int *state_fd)
+{
+    const char *value = getenv(UPGRADE_FD_ENV);
+    char byte;
+    struct iovec iov = {&byte, 1};
+    union
+    {
+        struct cmsghdr align;
+        char buf[CMSG_SPACE(2 * sizeof(int))];
+    } control;
+    struct msghdr msg;
+
+    *listen_fd = -1;
+    *state_fd = -1;
+    if (value == NULL)
+        return 0;
+
+    // Следующее обновление этого процесса не должно унаследовать переменную
+    int channel = atoi(value);
+    unsetenv(UPGRADE_FD_ENV);
+    fcntl(channel, F_SETFD, FD_CLOEXEC);
+
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control.buf;
+    msg.msg_controllen = sizeof(control.buf);
+
+    if (recvmsg(channel, &msg, MSG_CMSG_CLOEXEC) != 1)
+    {
+        perror("recvmsg");
+        close(channel);
+        return -1;
+    }
+
+    struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+    if (cmsg == NULL || cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS)
+    {
+        fprintf(stderr, "Обновление: предыдущий процесс не передал сокет\n");
+        close(channel);
+        return -1;
+    }
+
+    int fds[2] = {-1, -1};
+    size_t count = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+    memcpy(fds, CMSG_DATA(cmsg), (count > 2 ? 2 : count) * sizeof(int));
+    *listen_fd = fds[0];
+    *state_fd = count > 1 ? fds[1] : -1;
+
+    ready_channel = channel;
+    return 1;
+}
+
+void upgrade_ready(void)
+{
+    char byte = UPGRADE_READY_BYTE;
+
+    if (ready_channel < 0)
+        return;
+    if (write(ready_channel, &byte, 1) != 1)
+        perror("write");
+    close(ready_channel);
+    ready_channel = -1;
+}
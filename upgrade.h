@@ -0,0 +1,55 @@
+#ifndef UPGRADE_H
+#define UPGRADE_H
+
+#define UPGRADE_FD_ENV "UPGRADE_FD" /**< Переменная окружения с дескриптором канала передачи. */
+#define UPGRADE_READY_TIMEOUT 30    /**< Сколько секунд ждать готовности нового процесса. */
+
+/**
+ * @brief Записывает теплое состояние (снимок кэша) в переданный дескриптор.
+ *
+ * @return Количество записанных записей или -1 при ошибке.
+ */
+typedef long (*UpgradeStateFn)(int fd, void *arg);
+
+/**
+ * @brief Запоминает путь к исполняемому файлу и аргументы запуска.
+ *
+ * Вызывается в начале `main`: путь из /proc/self/exe берется до того, как
+ * файл будет заменен новой версией при выкладке.
+ *
+ * @param argv Аргументы командной строки (должны жить до конца процесса).
+ */
+void upgrade_init(char *argv[]);
+
+/**
+ * @brief Запускает новую версию сервера и передает ей слушающий сокет.
+ *
+ * Новый процесс запускается через fork + exec того же пути с теми же
+ * аргументами. По паре Unix-сокетов ему передаются (SCM_RIGHTS) слушающий
+ * сокет и memfd со снимком кэша, после чего функция ждет подтверждения
+ * готовности. Сокет все это время остается открытым и не удаляется с диска,
+ * поэтому клиенты не получают ECONNREFUSED.
+ *
+ * @param listen_fd Слушающий сокет.
+ * @param write_state Функция записи теплого состояния или NULL.
+ * @param arg Аргумент для `write_state`.
+ * @return 0, если новый процесс подтвердил готовность, -1 при ошибке (новый процесс остановлен).
+ */
+int upgrade_spawn(int listen_fd, UpgradeStateFn write_state, void *arg);
+
+/**
+ * @brief Принимает слушающий сокет и состояние от предыдущего процесса.
+ *
+ * @param listen_fd Полученный слушающий сокет.
+ * @param state_fd Полученный memfd со снимком кэша или -1.
+ * @return 1, если процесс запущен для замены старого и дескрипторы получены,
+ *         0 при обычном запуске, -1 при ошибке получения.
+ */
+int upgrade_receive(int *listen_fd, int *state_fd);
+
+/**
+ * @brief Сообщает предыдущему процессу, что новый готов принимать соединения.
+ */
+void upgrade_ready(void);
+
+#endif // UPGRADE_H
@@ -0,0 +1,644 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+
+#include "uring_server.h"
+#include "admission.h"
+#include "peer_limit.h"
+#include "probes.h"
+
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#endif
+
+// Multishot accept и кольца буферов появились в одной версии заголовков (ядро 5.19)
+#if defined(IORING_ACCEPT_MULTISHOT) && defined(__NR_io_uring_setup)
+
+/**
+ * @brief Тип операции, закодированный в младших битах user_data.
+ */
+enum
+{
+    OP_ACCEPT = 1,
+    OP_RECV = 2,
+    OP_SEND = 3,
+    OP_CLOSE = 4,
+    OP_CANCEL = 5,
+    OP_TIMEOUT = 6,
+    OP_LINK_TIMEOUT = 7,
+    OP_MASK = 7 /**< Все типы помещаются в три младших бита (calloc выравнивает хотя бы на 8). */
+};
+
+/**
+ * @brief Состояние одного соединения (живет от accept до завершения close).
+ */
+typedef struct
+{
+    int fd;              /**< Сокет клиента. */
+    char *response;      /**< Ответ, который отправляется клиенту. */
+    size_t response_len; /**< Длина ответа. */
+    uint64_t accepted_at; /**< Момент accept (admission_now_ms) для дедлайна запроса. */
+} Connection;
+
+/**
+ * @brief Кольца io_uring, отображенные в память процесса.
+ */
+typedef struct
+{
+    int fd;
+    void *ring_ptr;
+    size_t ring_len;
+    struct io_uring_sqe *sqes;
+    size_t sqes_len;
+    unsigned *sq_head, *sq_tail, *sq_mask, *sq_array;
+    unsigned sq_entries;
+    unsigned sqe_tail; /**< Хвост очереди отправки, еще не опубликованный ядру. */
+    unsigned *cq_head, *cq_tail, *cq_mask;
+    struct io_uring_cqe *cqes;
+    int skip_success; /**< Ядро умеет не присылать CQE для успешного send. */
+
+    struct io_uring_buf_ring *buf_ring;
+    size_t buf_ring_len;
+    char *buffers;
+    unsigned short buf_tail;
+
+    unsigned long enter_calls; /**< Количество вызовов io_uring_enter (для статистики). */
+
+    struct __kernel_timespec header_timeout; /**< Таймаут recv запроса. */
+    struct __kernel_timespec write_timeout;  /**< Таймаут send ответа. */
+    int header_timeout_set;                  /**< Таймаут recv задан (иначе ждем без ограничения). */
+    int write_timeout_set;                   /**< Таймаут send задан. */
+} Ring;
+
+/**
+ * @brief Упаковывает указатель на соединение и тип операции в user_data.
+ */
+static uint64_t make_user_data(Connection *conn, int op)
+{
+    return (uint64_t)(uintptr_t)conn | (uint64_t)op;
+}
+
+static int ring_setup(Ring *ring, unsigned entries)
+{
+    struct io_uring_params params;
+
+    memset(ring, 0, sizeof(*ring));
+    memset(&params, 0, sizeof(params));
+#if defined(IORING_SETUP_SINGLE_ISSUER) && defined(IORING_SETUP_COOP_TASKRUN)
+    // С кольцом работает один поток: ядру не нужно прерывать его для выполнения task_work
+    params.flags = IORING_SETUP_SINGLE_ISSUER | IORING_SETUP_COOP_TASKRUN;
+#endif
+    ring->fd = syscall(__NR_io_uring_setup, entries, &params);
+    if (ring->fd < 0 && errno == EINVAL)
+    {
+        memset(&params, 0, sizeof(params));
+        ring->fd = syscall(__NR_io_uring_setup, entries, &params);
+    }
+    if (ring->fd < 0)
+        return -1;
+
+    if (!(params.features & IORING_FEAT_SINGLE_MMAP))
+    {
+        close(ring->fd);
+        errno = ENOSYS;
+        return -1;
+    }
+    ring->skip_success = (params.features & IORING_FEAT_CQE_SKIP) != 0;
+
+    // Очереди отправки и завершения отображаются одним mmap
+    size_t sq_len = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    size_t cq_len = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    ring->ring_len = sq_len > cq_len ? sq_len : cq_len;
+    ring->ring_ptr = mmap(NULL, ring->ring_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                          ring->fd, IORING_OFF_SQ_RING);
+    if (ring->ring_ptr == MAP_FAILED)
+    {
+        close(ring->fd);
+        return -1;
+    }
+
+    ring->sqes_len = params.sq_entries * sizeof(struct io_uring_sqe);
+    ring->sqes = mmap(NULL, ring->sqes_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                      ring->fd, IORING_OFF_SQES);
+    if (ring->sqes == MAP_FAILED)
+    {
+        munmap(ring->ring_ptr, ring->ring_len);
+        close(ring->fd);
+        return -1;
+    }
+
+    char *base = ring->ring_ptr;
+    ring->sq_head = (unsigned *)(base + params.sq_off.head);
+    ring->sq_tail = (unsigned *)(base + params.sq_off.tail);
+    ring->sq_mask = (unsigned *)(base + params.sq_off.ring_mask);
+    ring->sq_array = (unsigned *)(base + params.sq_off.array);
+    ring->sq_entries = params.sq_entries;
+    ring->sqe_tail = *ring->sq_tail;
+    ring->cq_head = (unsigned *)(base + params.cq_off.head);
+    ring->cq_tail = (unsigned *)(base + params.cq_off.tail);
+    ring->cq_mask = (unsigned *)(base + params.cq_off.ring_mask);
+    ring->cqes = (struct io_uring_cqe *)(base + params.cq_off.cqes);
+
+    return 0;
+}
+
+/**
+ * @brief Возвращает буфер в кольцо, откуда ядро выбирает буферы для recv.
+ */
+static void recycle_buffer(Ring *ring, unsigned short bid)
+{
+    struct io_uring_buf *buf = &ring->buf_ring->bufs[ring->buf_tail & (URING_BUFFER_COUNT - 1)];
+
+    buf->addr = (uint64_t)(uintptr_t)(ring->buffers + (size_t)bid * URING_BUFFER_SIZE);
+    buf->len = URING_BUFFER_SIZE;
+    buf->bid = bid;
+    ring->buf_tail++;
+    __atomic_store_n(&ring->buf_ring->tail, ring->buf_tail, __ATOMIC_RELEASE);
+}
+
+static int setup_buffers(Ring *ring)
+{
+    struct io_uring_buf_reg reg;
+
+    ring->buf_ring_len = URING_BUFFER_COUNT * sizeof(struct io_uring_buf);
+    ring->buf_ring = mmap(NULL, ring->buf_ring_len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (ring->buf_ring == MAP_FAILED)
+    {
+        ring->buf_ring = NULL;
+        return -1;
+    }
+
+    ring->buffers = malloc((size_t)URING_BUFFER_COUNT * URING_BUFFER_SIZE);
+    if (ring->buffers == NULL)
+        return -1;
+
+    memset(&reg, 0, sizeof(reg));
+    reg.ring_addr = (uint64_t)(uintptr_t)ring->buf_ring;
+    reg.ring_entries = URING_BUFFER_COUNT;
+    reg.bgid = 0;
+    if (syscall(__NR_io_uring_register, ring->fd, IORING_REGISTER_PBUF_RING, &reg, 1) < 0)
+        return -1;
+
+    for (unsigned short i = 0; i < URING_BUFFER_COUNT; i++)
+        recycle_buffer(ring, i);
+    return 0;
+}
+
+static void ring_teardown(Ring *ring)
+{
+    // Закрытие дескриптора кольца отменяет все незавершенные операции
+    close(ring->fd);
+    munmap(ring->sqes, ring->sqes_len);
+    munmap(ring->ring_ptr, ring->ring_len);
+    if (ring->buf_ring != NULL)
+        munmap(ring->buf_ring, ring->buf_ring_len);
+    free(ring->buffers);
+}
+
+/**
+ * @brief Публикует накопленные заявки и, если `wait`, ждет хотя бы одно завершение.
+ */
+static int ring_submit(Ring *ring, unsigned wait)
+{
+    unsigned to_submit = ring->sqe_tail - *ring->sq_tail;
+
+    __atomic_store_n(ring->sq_tail, ring->sqe_tail, __ATOMIC_RELEASE);
+    ring->enter_calls++;
+    return syscall(__NR_io_uring_enter, ring->fd, to_submit, wait, wait ? IORING_ENTER_GETEVENTS : 0, NULL, 0);
+}
+
+/**
+ * @brief Гарантирует `count` свободных мест в очереди отправки (связанные заявки
+ * должны попасть в ядро одним вызовом).
+ */
+static int ring_reserve(Ring *ring, unsigned count)
+{
+    if (ring->sqe_tail - __atomic_load_n(ring->sq_head, __ATOMIC_ACQUIRE) + count <= ring->sq_entries)
+        return 0;
+
+    ring_submit(ring, 0);
+    return ring->sqe_tail - __atomic_load_n(ring->sq_head, __ATOMIC_ACQUIRE) + count <= ring->sq_entries ? 0 : -1;
+}
+
+/**
+ * @brief Выделяет очередную заявку (место должно быть зарезервировано `ring_reserve`).
+ */
+static struct io_uring_sqe *ring_get_sqe(Ring *ring)
+{
+    unsigned index = ring->sqe_tail & *ring->sq_mask;
+    struct io_uring_sqe *sqe = &ring->sqes[index];
+
+    memset(sqe, 0, sizeof(*sqe));
+    ring->sq_array[index] = index;
+    ring->sqe_tail++;
+    return sqe;
+}
+
+static int queue_accept(Ring *ring, int server_sock, int multishot)
+{
+    if (ring_reserve(ring, 1) < 0)
+        return -1;
+
+    struct io_uring_sqe *sqe = ring_get_sqe(ring);
+    sqe->opcode = IORING_OP_ACCEPT;
+    sqe->fd = server_sock;
+    sqe->ioprio = multishot ? IORING_ACCEPT_MULTISHOT : 0;
+    sqe->user_data = make_user_data(NULL, OP_ACCEPT);
+    return 0;
+}
+
+/**
+ * @brief Добавляет таймаут к предыдущей заявке (та должна быть поставлена с IOSQE_IO_LINK).
+ *
+ * По истечении ядро отменяет заявку, и она завершается с -ECANCELED. Указатель на
+ * `timeout` ядро читает при отправке заявки, поэтому структура живет в `Ring`.
+ */
+static void queue_link_timeout(Ring *ring, struct __kernel_timespec *timeout)
+{
+    struct io_uring_sqe *sqe = ring_get_sqe(ring);
+    sqe->opcode = IORING_OP_LINK_TIMEOUT;
+    sqe->addr = (uint64_t)(uintptr_t)timeout;
+    sqe->len = 1;
+    sqe->user_data = make_user_data(NULL, OP_LINK_TIMEOUT);
+}
+
+static int queue_recv(Ring *ring, Connection *conn)
+{
+    if (ring_reserve(ring, ring->header_timeout_set ? 2 : 1) < 0)
+        return -1;
+
+    // Буфер выбирает ядро из кольца в момент прихода данных, а не при постановке заявки
+    struct io_uring_sqe *sqe = ring_get_sqe(ring);
+    sqe->opcode = IORING_OP_RECV;
+    sqe->fd = conn->fd;
+    sqe->len = URING_BUFFER_SIZE;
+    sqe->flags = IOSQE_BUFFER_SELECT | (ring->header_timeout_set ? IOSQE_IO_LINK : 0);
+    sqe->buf_group = 0;
+    sqe->user_data = make_user_data(conn, OP_RECV);
+
+    // Клиент, не приславший запрос вовремя, не держит соединение бесконечно
+    if (ring->header_timeout_set)
+        queue_link_timeout(ring, &ring->header_timeout);
+    return 0;
+}
+
+static int queue_close(Ring *ring, Connection *conn)
+{
+    if (ring_reserve(ring, 1) < 0)
+        return -1;
+
+    struct io_uring_sqe *sqe = ring_get_sqe(ring);
+    sqe->opcode = IORING_OP_CLOSE;
+    sqe->fd = conn->fd;
+    sqe->user_data = make_user_data(conn, OP_CLOSE);
+    return 0;
+}
+
+static int queue_send_close(Ring *ring, Connection *conn)
+{
+    if (ring_reserve(ring, 2) < 0)
+        return -1;
+
+    // close выполняется только после успешного send (IOSQE_IO_LINK)
+    struct io_uring_sqe *sqe = ring_get_sqe(ring);
+    sqe->opcode = IORING_OP_SEND;
+    sqe->fd = conn->fd;
+    sqe->addr = (uint64_t)(uintptr_t)conn->response;
+    sqe->len = conn->response_len;
+    sqe->msg_flags = MSG_WAITALL | MSG_NOSIGNAL;
+    sqe->flags = IOSQE_IO_LINK | (ring->skip_success ? IOSQE_CQE_SKIP_SUCCESS : 0);
+    sqe->user_data = make_user_data(conn, OP_SEND);
+
+    // Цепочка после связанного таймаута не продолжается: close ставится по завершении send
+    if (ring->write_timeout_set)
+    {
+        sqe->flags = IOSQE_IO_LINK;
+        queue_link_timeout(ring, &ring->write_timeout);
+        return 0;
+    }
+
+    sqe = ring_get_sqe(ring);
+    sqe->opcode = IORING_OP_CLOSE;
+    sqe->fd = conn->fd;
+    sqe->user_data = make_user_data(conn, OP_CLOSE);
+    return 0;
+}
+
+/**
+ * @brief Отменяет заявку accept, чтобы перестать принимать новые соединения.
+ */
+static int queue_cancel_accept(Ring *ring)
+{
+    if (ring_reserve(ring, 1) < 0)
+        return -1;
+
+    struct io_uring_sqe *sqe = ring_get_sqe(ring);
+    sqe->opcode = IORING_OP_ASYNC_CANCEL;
+    sqe->addr = make_user_data(NULL, OP_ACCEPT);
+    sqe->user_data = make_user_data(NULL, OP_CANCEL);
+    return 0;
+}
+
+/**
+ * @brief Ставит таймер.
+ *
+ * `tag` отличает таймеры в CQE: NULL - время дообслуживания соединений при
+ * остановке, иначе - период закрытия отклоненных соединений.
+ */
+static int queue_timeout(Ring *ring, struct __kernel_timespec *timeout, Connection *tag)
+{
+    if (ring_reserve(ring, 1) < 0)
+        return -1;
+
+    struct io_uring_sqe *sqe = ring_get_sqe(ring);
+    sqe->opcode = IORING_OP_TIMEOUT;
+    sqe->addr = (uint64_t)(uintptr_t)timeout;
+    sqe->len = 1;
+    sqe->user_data = make_user_data(tag, OP_TIMEOUT);
+    return 0;
+}
+
+/**
+ * @brief Закрывает соединение в обход кольца (когда заявку поставить не удалось).
+ */
+static void drop_connection(Connection *conn)
+{
+    PROBE1(request__done, conn->fd);
+    close(conn->fd);
+    free(conn->response);
+    free(conn);
+}
+
+/**
+ * @brief Переводит миллисекунды в timespec для io_uring.
+ */
+static void set_timespec(struct __kernel_timespec *ts, unsigned int ms)
+{
+    ts->tv_sec = ms / 1000;
+    ts->tv_nsec = (long long)(ms % 1000) * 1000000;
+}
+
+int uring_serve(int server_sock, int multishot, const ConnectionLimits *limits, UringResponseFn fn, void *arg,
+                volatile sig_atomic_t *stop, SocketStopFn on_stop)
+{
+    Ring ring;
+    struct __kernel_timespec drain_timeout = {URING_DRAIN_TIMEOUT, 0};
+    struct __kernel_timespec reap_interval = {0, URING_SHED_REAP_MS * 1000000LL};
+    Connection *reap_tag = (Connection *)(void *)&reap_interval; /**< Метка таймера закрытия отклоненных. */
+    int reap_armed = 0;
+    unsigned long requests = 0;
+    unsigned long live = 0; /**< Принятые соединения, для которых еще не завершен close. */
+    unsigned long header_timeouts = 0;
+    unsigned long write_timeouts = 0;
+    int accepted_any = 0;
+    int unsupported = 0;
+    int accept_armed = 0;
+    int draining = 0;
+    int drain_expired = 0;
+    PeerInfo peer;
+
+    if (ring_setup(&ring, URING_QUEUE_DEPTH) < 0)
+    {
+        perror("io_uring_setup");
+        return -1;
+    }
+    if (setup_buffers(&ring) < 0)
+    {
+        perror("io_uring_register");
+        ring_teardown(&ring);
+        return -1;
+    }
+    set_timespec(&ring.header_timeout, limits->header_timeout_ms);
+    set_timespec(&ring.write_timeout, limits->write_timeout_ms);
+    ring.header_timeout_set = limits->header_timeout_ms > 0;
+    ring.write_timeout_set = limits->write_timeout_ms > 0;
+    accept_armed = queue_accept(&ring, server_sock, multishot) == 0;
+
+    while (!unsupported)
+    {
+        // Перед дренажом даем вызывающему передать слушающий сокет (он может и отменить остановку)
+        if (*stop && !draining && on_stop != NULL)
+            on_stop(arg);
+
+        // При остановке перестаем принимать соединения и дообслуживаем уже принятые
+        if (*stop)
+        {
+            if ((!accept_armed && live == 0) || drain_expired)
+                break;
+            if (!draining)
+            {
+                draining = 1;
+                if (accept_armed)
+                    queue_cancel_accept(&ring);
+                queue_timeout(&ring, &drain_timeout, NULL);
+            }
+        }
+
+        // Отклоненные соединения закрываются после пачки CQE, а на простаивающем кольце - по таймеру
+        if (!reap_armed && admission_shed_pending() > 0)
+            reap_armed = queue_timeout(&ring, &reap_interval, reap_tag) == 0;
+
+        if (ring_submit(&ring, 1) < 0 && errno != EINTR && errno != EBUSY)
+        {
+            perror("io_uring_enter");
+            break;
+        }
+
+        unsigned head = *ring.cq_head;
+        unsigned tail = __atomic_load_n(ring.cq_tail, __ATOMIC_ACQUIRE);
+
+        for (; head != tail; head++)
+        {
+            struct io_uring_cqe *cqe = &ring.cqes[head & *ring.cq_mask];
+            Connection *conn = (Connection *)(uintptr_t)(cqe->user_data & ~(uint64_t)OP_MASK);
+            int res = cqe->res;
+
+            switch (cqe->user_data & OP_MASK)
+            {
+            case OP_ACCEPT:
+                if (res >= 0 && (live >= admission_queue_depth() || live >= limits->max_connections))
+                {
+                    // Очередь ожидающих ответа соединений заполнена - сразу 503
+                    accepted_any = 1;
+                    admission_shed_connection(res, SHED_QUEUE_FULL);
+                }
+                else if (res >= 0 && peer_limit_enabled() && !peer_limit_admit(res, &peer))
+                {
+                    accepted_any = 1;
+                    admission_shed_connection(res, SHED_RATE_LIMIT);
+                }
+                else if (res >= 0)
+                {
+                    accepted_any = 1;
+                    conn = calloc(1, sizeof(Connection));
+                    if (conn == NULL)
+                        close(res);
+                    else
+                    {
+                        conn->fd = res;
+                        conn->accepted_at = admission_now_ms();
+                        live++;
+                        if (queue_recv(&ring, conn) < 0)
+                        {
+                            drop_connection(conn);
+                            live--;
+                        }
+                    }
+                }
+                else if (res == -EINVAL && !accepted_any)
+                {
+                    // Ядро знает io_uring, но не multishot accept
+                    unsupported = 1;
+                    break;
+                }
+                else if (res != -ECANCELED)
+                {
+                    fprintf(stderr, "accept: %s\n", strerror(-res));
+                }
+
+                // Multishot accept снимается ядром при ошибке - ставим заново (кроме остановки)
+                if (!(cqe->flags & IORING_CQE_F_MORE))
+                    accept_armed = !draining && queue_accept(&ring, server_sock, multishot) == 0;
+                break;
+
+            case OP_RECV:
+                if (res == -ENOBUFS)
+                {
+                    // Все буферы заняты в этой пачке завершений - повторим, когда вернутся
+                    if (queue_recv(&ring, conn) < 0)
+                    {
+                        drop_connection(conn);
+                        live--;
+                    }
+                    break;
+                }
+                if (res > 0 && (cqe->flags & IORING_CQE_F_BUFFER))
+                {
+                    unsigned short bid = cqe->flags >> IORING_CQE_BUFFER_SHIFT;
+                    char request[URING_BUFFER_SIZE + 1];
+
+                    // Копируем запрос и сразу возвращаем буфер ядру
+                    memcpy(request, ring.buffers + (size_t)bid * URING_BUFFER_SIZE, res);
+                    request[res] = '\0';
+                    recycle_buffer(&ring, bid);
+
+                    admission_begin(conn->accepted_at);
+                    PROBE1(request__start, conn->fd);
+                    conn->response = fn(request, &conn->response_len, arg);
+                    PROBE2(request__built, conn->fd, conn->response_len);
+                    admission_end();
+                    if (conn->response != NULL && queue_send_close(&ring, conn) == 0)
+                        break;
+                }
+                else if (cqe->flags & IORING_CQE_F_BUFFER)
+                {
+                    recycle_buffer(&ring, cqe->flags >> IORING_CQE_BUFFER_SHIFT);
+                }
+
+                if (res == -ECANCELED)
+                    header_timeouts++;
+                else if (res < 0)
+                    fprintf(stderr, "recv: %s\n", strerror(-res));
+                if (queue_close(&ring, conn) < 0)
+                {
+                    drop_connection(conn);
+                    live--;
+                }
+                break;
+
+            case OP_SEND:
+                // С таймаутом записи send прерывается с -ECANCELED или отправив часть ответа
+                if (ring.write_timeout_set)
+                {
+                    if (res == -ECANCELED || (res >= 0 && (size_t)res < conn->response_len))
+                        write_timeouts++;
+                    else if (res < 0)
+                        fprintf(stderr, "send: %s\n", strerror(-res));
+                    if (queue_close(&ring, conn) < 0)
+                    {
+                        drop_connection(conn);
+                        live--;
+                    }
+                    break;
+                }
+
+                // При успехе CQE не приходит (IOSQE_CQE_SKIP_SUCCESS), ошибку пишем в лог
+                if (res < 0)
+                    fprintf(stderr, "send: %s\n", strerror(-res));
+                break;
+
+            case OP_LINK_TIMEOUT:
+                // Сработавший таймаут уже учтен по отмененной заявке
+                break;
+
+            case OP_CLOSE:
+                // Если send не удался, связанный close отменяется - закрываем сами
+                if (res == -ECANCELED)
+                    close(conn->fd);
+                PROBE1(request__done, conn->fd);
+                free(conn->response);
+                free(conn);
+                requests++;
+                live--;
+                break;
+
+            case OP_TIMEOUT:
+                if (conn == reap_tag)
+                {
+                    reap_armed = 0;
+                    break;
+                }
+                if (live > 0)
+                    fprintf(stderr, "io_uring: не дождались завершения соединений: %lu\n", live);
+                drain_expired = 1;
+                break;
+            }
+
+            if (unsupported)
+                break;
+        }
+
+        __atomic_store_n(ring.cq_head, head, __ATOMIC_RELEASE);
+        admission_reap_shed(0);
+    }
+
+    admission_reap_shed(1);
+    ring_teardown(&ring);
+
+    if (unsupported)
+    {
+        fprintf(stderr, "io_uring: multishot accept не поддерживается ядром\n");
+        return -1;
+    }
+
+    printf("io_uring: обработано запросов: %lu, вызовов io_uring_enter: %lu (%.2f на запрос), "
+           "закрыто по таймауту: заголовки %lu, запись %lu\n",
+           requests, ring.enter_calls, requests > 0 ? (double)ring.enter_calls / requests : 0.0,
+           header_timeouts, write_timeouts);
+    return 0;
+}
+
+#else
+
+int uring_serve(int server_sock, int multishot, const ConnectionLimits *limits, UringResponseFn fn, void *arg,
+                volatile sig_atomic_t *stop, SocketStopFn on_stop)
+{
+    (void)server_sock;
+    (void)multishot;
+    (void)limits;
+    (void)fn;
+    (void)arg;
+    (void)stop;
+    (void)on_stop;
+    fprintf(stderr, "io_uring: сервер собран без поддержки io_uring\n");
+    return -1;
+}
+
+#endif
@@ -0,0 +1,70 @@
+#ifndef URING_SERVER_H
+#define URING_SERVER_H
+
+#include <stddef.h>
+#include <signal.h>
+
+#include "socket_server.h" // For ConnectionLimits
+
+#define URING_QUEUE_DEPTH 256  /**< Размер очереди отправки кольца. */
+#define URING_BUFFER_COUNT 256 /**< Количество буферов в кольце буферов для recv (степень двойки). */
+#define URING_BUFFER_SIZE 1024 /**< Размер одного буфера для recv. */
+#define URING_DRAIN_TIMEOUT 10 /**< Сколько секунд дообслуживать принятые соединения при остановке. */
+#define URING_SHED_REAP_MS 100 /**< Период закрытия отклоненных соединений, пока кольцо простаивает. */
+
+/**
+ * @brief Формирует ответ на запрос клиента.
+ *
+ * @param request Текст запроса, завершенный нулем.
+ * @param response_len Длина ответа.
+ * @param arg Аргумент, переданный в `uring_serve`.
+ * @return Ответ, выделенный через malloc (освобождает вызывающий), или NULL.
+ */
+typedef char *(*UringResponseFn)(const char *request, size_t *response_len, void *arg);
+
+/**
+ * @brief Обслуживает соединения через io_uring, пока `*stop` не станет ненулевым.
+ *
+ * Используются multishot accept (одна заявка принимает все соединения), recv из
+ * кольца предоставленных ядру буферов и связанная пара send+close, так что на
+ * одну итерацию цикла приходится один вызов `io_uring_enter` на все готовые
+ * соединения. Ответ формируется синхронно в том же потоке: промах кэша с
+ * обращением к DNS задерживает остальные соединения, поэтому режим стоит
+ * сочетать с `--workers`.
+ *
+ * Multishot accept остается взведенным, даже пока поток занят ответом, и ядро
+ * продолжает отдавать этому кольцу новые соединения. Когда слушающий сокет делят
+ * несколько процессов, следует передавать `multishot = 0`: тогда занятый процесс
+ * удерживает не больше одного принятого соединения, а остальные достаются свободным.
+ *
+ * Если ядро не поддерживает io_uring или нужные операции (ядра старше 5.19,
+ * запрет через seccomp), функция возвращает -1, не приняв ни одного соединения,
+ * и вызывающий может перейти на обычные сокеты.
+ *
+ * Соединения сверх глубины очереди (`admission_queue_depth`) сразу получают 503,
+ * а ответ формируется с дедлайном, отсчитанным от accept. С `--peer-limit` клиенты,
+ * превысившие скорость, получают 429; справедливой очереди здесь нет, потому что
+ * запросы обрабатываются сразу по мере получения.
+ *
+ * При остановке сначала вызывается `on_stop` (если задана), затем заявка accept отменяется (новые соединения остаются в очереди
+ * слушающего сокета, например для процесса, которому сокет передан), а уже
+ * принятые соединения дообслуживаются не дольше URING_DRAIN_TIMEOUT секунд.
+ *
+ * Таймауты заголовков и записи из `limits` ставятся связанными заявками
+ * IORING_OP_LINK_TIMEOUT после recv и send, так что медленный клиент закрывается
+ * без отдельного таймера. Запрос здесь читается одним recv, поэтому таймаут тела
+ * не используется, а `max_connections` ограничивает соединения наравне с глубиной очереди.
+ *
+ * @param server_sock Слушающий сокет.
+ * @param multishot 1 - multishot accept, 0 - однократный accept с повторной постановкой.
+ * @param limits Таймауты и предел соединений.
+ * @param fn Функция формирования ответа.
+ * @param arg Аргумент для `fn` и `on_stop`.
+ * @param stop Флаг остановки, выставляемый обработчиком сигнала.
+ * @param on_stop Функция, вызываемая перед дренажом, или NULL (см. `SocketStopFn`).
+ * @return 0 после остановки, -1 если io_uring недоступен.
+ */
+int uring_serve(int server_sock, int multishot, const ConnectionLimits *limits, UringResponseFn fn, void *arg,
+                volatile sig_atomic_t *stop, SocketStopFn on_stop);
+
+#endif // URING_SERVER_H